@@ -0,0 +1,215 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Parameters/CacheConfig.cpp"
+#include "Parameters/LatencyModel.cpp"
+#include "Trace/MappedFile.cpp"
+#include "Trace/TraceReader.cpp"
+
+// removes a scratch file when it goes out of scope, however the run ends; an empty path is no file
+class ScratchFile {
+public:
+    std::string path;
+
+    explicit ScratchFile(std::string path = {}) : path(std::move(path)) {}
+    ScratchFile(const ScratchFile&) = delete;
+    ScratchFile& operator=(const ScratchFile&) = delete;
+    ~ScratchFile() {
+        std::error_code ignored;
+        if (!path.empty()) std::filesystem::remove(path, ignored);
+    }
+};
+
+// Belady's MIN: the offline optimal policy, evicting the resident line whose next use lies furthest in
+// the future. Nothing online can hit more often with the same geometry (lines are always allocated,
+// as the other models do), so it bounds how far a real policy is from the best possible.
+//
+// Works on a recorded trace in two passes. The backward pass walks the chunks last to first and
+// writes, for every line access, the distance to the next access of the same line into a scratch file
+// (0 when there is none, distances past 2^32 count as none). The forward pass streams those distances
+// back next to the trace and keeps each set as a max-heap on next use, so a miss evicts the root.
+// Memory is one chunk plus a map over the distinct lines touched; time is linear in the trace.
+class BeladyOPT {
+public:
+    static constexpr uint64_t NEVER = UINT64_MAX;
+
+    std::string name;
+    CacheConfig config;
+    uint64_t accesses = 0;      // line lookups, two for a line-crossing access
+    uint64_t hits = 0;
+    uint64_t evictions = 0;
+    uint64_t writebacks = 0;
+
+    explicit BeladyOPT(const CacheConfig& config)
+            : name("OPT " + std::to_string(config.size) + "B " + std::to_string(config.ways) + "-way " +
+                   std::to_string(config.lineSize) + "B"),
+              config(config) {}
+
+    // scratch is a file for the next-use distances, 4 bytes per access; it is removed afterwards
+    void run(const TraceReader& reader, const std::string& scratch) {
+        ScratchFile file(scratch);
+        std::vector<uint64_t> offsets = nextUses(reader, scratch);
+        MappedFile distances(scratch);
+        simulate(reader, offsets, reinterpret_cast<const uint32_t*>(distances.data));
+    }
+
+    [[nodiscard]] double hitRate() const { return accesses ? static_cast<double>(hits) / accesses * 100 : 0.0; }
+    [[nodiscard]] uint64_t misses() const { return accesses - hits; }
+    [[nodiscard]] uint64_t cycles(const LatencyModel& latency) const {
+        return accesses * latency.hit + misses() * latency.memory + writebacks * latency.writeback;
+    }
+
+    void print(const LatencyModel& latency) const {
+        std::printf("%s\thit rate: %3.4f%%\tmisses %llu\tevictions %llu\twritebacks %llu\tread %llu B\twritten %llu B"
+                    "\tAMAT %.2f cycles\tmemory cycles %llu\n", name.c_str(), hitRate(), (unsigned long long)misses(),
+                    (unsigned long long)evictions, (unsigned long long)writebacks,
+                    (unsigned long long)misses() * config.lineSize, (unsigned long long)writebacks * config.lineSize,
+                    accesses ? static_cast<double>(cycles(latency)) / accesses : 0.0, (unsigned long long)cycles(latency));
+    }
+
+private:
+    struct Way {
+        uint64_t next;
+        uint32_t line;
+        bool dirty;
+    };
+
+    // calls f(line, type) for every line the records touch, in order; like the models, only the low
+    // addrLen bits of an address count
+    template<class F>
+    void forEachLine(const TraceRecord* records, uint32_t count, F&& f) const {
+        const uint32_t mask = static_cast<uint32_t>((1ull << (config.addrLen - config.offsetLen)) - 1);
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t first = records[i].address >> config.offsetLen,
+                    last = (records[i].address + records[i].size - 1) >> config.offsetLen;
+            f(first & mask, records[i].type);
+            if (last != first) f(last & mask, records[i].type);
+        }
+    }
+
+    // writes the distances and returns where those of each chunk start in the scratch file, in accesses
+    std::vector<uint64_t> nextUses(const TraceReader& reader, const std::string& scratch) const {
+        std::ofstream out(scratch, std::ios::binary);
+        if (!out) throw std::runtime_error("Cannot create scratch file: " + scratch);
+        std::vector<uint64_t> offsets(reader.chunks.size());
+        std::unordered_map<uint32_t, uint64_t> seen;    // line -> index of its latest access, counted from the end
+        std::vector<TraceRecord> records(TRACE_CHUNK_RECORDS);
+        std::vector<uint32_t> lines, distances;
+        uint64_t fromEnd = 0, written = 0;
+        for (size_t c = reader.chunks.size(); c-- > 0;) {
+            reader.decode(reader.chunks[c], records.data());
+            lines.clear();
+            forEachLine(records.data(), reader.chunks[c].records, [&](uint32_t line, Type) { lines.push_back(line); });
+            distances.resize(lines.size());
+            for (size_t i = lines.size(); i-- > 0; ++fromEnd) {
+                auto [it, first] = seen.try_emplace(lines[i], fromEnd);
+                uint64_t distance = first ? 0 : fromEnd - it->second;
+                distances[i] = distance > UINT32_MAX ? 0 : static_cast<uint32_t>(distance);
+                it->second = fromEnd;
+            }
+            out.write(reinterpret_cast<const char*>(distances.data()), distances.size() * sizeof(uint32_t));
+            offsets[c] = written;
+            written += distances.size();
+        }
+        if (!out) throw std::runtime_error("Cannot write scratch file: " + scratch);
+        return offsets;
+    }
+
+    void simulate(const TraceReader& reader, const std::vector<uint64_t>& offsets, const uint32_t* distances) {
+        std::vector<Way> heaps(config.sets * config.ways);
+        std::vector<uint32_t> used(config.sets);
+        std::vector<TraceRecord> records(TRACE_CHUNK_RECORDS);
+        for (size_t c = 0; c < reader.chunks.size(); ++c) {
+            reader.decode(reader.chunks[c], records.data());
+            const uint32_t* distance = distances + offsets[c];
+            forEachLine(records.data(), reader.chunks[c].records, [&](uint32_t line, Type type) {
+                uint64_t next = *distance ? accesses + *distance : NEVER;
+                ++distance;
+                ++accesses;
+                uint32_t index = line & (config.sets - 1);
+                Way* heap = &heaps[index * config.ways];
+                uint32_t& size = used[index];
+                for (uint32_t slot = 0; slot < size; ++slot) {
+                    if (heap[slot].line != line) continue;
+                    ++hits;
+                    heap[slot].next = next;     // the old key was now, the smallest in the set
+                    heap[slot].dirty |= type == Type(w);
+                    siftUp(heap, slot);
+                    return;
+                }
+                Way way{next, line, type == Type(w)};
+                if (size < config.ways) {
+                    heap[size] = way;
+                    siftUp(heap, size++);
+                    return;
+                }
+                ++evictions;
+                writebacks += heap[0].dirty;
+                heap[0] = way;
+                siftDown(heap, size);
+            });
+        }
+    }
+
+    static void siftUp(Way* heap, uint32_t slot) {
+        while (slot > 0) {
+            uint32_t parent = (slot - 1) / 2;
+            if (heap[parent].next >= heap[slot].next) return;
+            std::swap(heap[parent], heap[slot]);
+            slot = parent;
+        }
+    }
+    static void siftDown(Way* heap, uint32_t size) {
+        for (uint32_t slot = 0;;) {
+            uint32_t largest = slot, left = 2 * slot + 1, right = left + 1;
+            if (left < size && heap[left].next > heap[largest].next) largest = left;
+            if (right < size && heap[right].next > heap[largest].next) largest = right;
+            if (largest == slot) return;
+            std::swap(heap[slot], heap[largest]);
+            slot = largest;
+        }
+    }
+};
+
+// a file name in the temp directory that no other run uses
+inline std::string optScratchPath(const std::string& suffix) {
+    static std::atomic<uint32_t> serial{0};
+    return (std::filesystem::temp_directory_path() /
+            ("cache_sim_opt_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "_" +
+             std::to_string(serial++) + suffix)).string();
+}
+
+// Runs every OPT model over the trace, one thread each up to threads; the first model that fails
+// rethrows its error once all threads are done.
+inline void runOPT(std::vector<BeladyOPT>& models, const TraceReader& reader, unsigned threads) {
+    threads = std::max(1u, std::min<unsigned>(threads, models.size()));
+    std::vector<std::exception_ptr> errors(models.size());
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (size_t i = t; i < models.size(); i += threads) {
+                try {
+                    models[i].run(reader, optScratchPath(".next"));
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    for (const auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include "Parameters/CacheConfig.cpp"
+
+// Three-C classification of the misses of one cache (Hill): a miss is compulsory on the first access
+// to a line, capacity when a fully associative LRU cache of the same size would miss as well, and
+// conflict when only the set mapping is to blame. The fully associative shadow sees every access of
+// the cache it shadows, so it has to be told about hits too.
+class MissClassifier {
+public:
+    uint64_t compulsory = 0;
+    uint64_t capacity = 0;
+    uint64_t conflict = 0;
+
+    MissClassifier(uint32_t lineCount, uint32_t lineSize) : lineCount(lineCount), offsetLen(CacheConfig::log2(lineSize)) {}
+
+    void access(uint32_t address, bool hit) {
+        uint32_t line = address >> offsetLen;
+        auto [it, first] = lines.try_emplace(line);
+        Entry& entry = it->second;
+        bool shadowHit = entry.resident;
+        if (shadowHit) {
+            lru.splice(lru.begin(), lru, entry.position);
+        } else {
+            lru.push_front(line);
+            entry.position = lru.begin();
+            entry.resident = true;
+            if (lru.size() > lineCount) {
+                lines[lru.back()].resident = false;
+                lru.pop_back();
+            }
+        }
+        if (hit) return;
+        if (first) ++compulsory;
+        else if (!shadowHit) ++capacity;
+        else ++conflict;
+    }
+
+private:
+    struct Entry {
+        std::list<uint32_t>::iterator position;
+        bool resident = false;      // held by the fully associative shadow
+    };
+
+    uint32_t lineCount;
+    uint32_t offsetLen;
+    std::list<uint32_t> lru;        // shadow contents, most recent first
+    std::unordered_map<uint32_t, Entry> lines;  // every line ever touched
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// text as a JSON string literal, quotes included
+inline std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (char ch : text) {
+        if (ch == '"' || ch == '\\') {
+            quoted += '\\';
+            quoted += ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", ch);
+            quoted += escape;
+        } else {
+            quoted += ch;
+        }
+    }
+    return quoted + "\"";
+}
+
+// Miss attribution per static instruction. Counters sit in a flat array parallel to the program's
+// code, so recording an access is an index computation and three increments; accesses from outside
+// the code (none in practice) are dropped.
+class PcProfile {
+public:
+    struct Counters {
+        uint64_t accesses = 0;      // dynamic executions of the load or store
+        uint64_t misses = 0;        // lookups of the profiled cache that missed, two for a line-crossing access
+        uint64_t writebacks = 0;    // dirty lines its misses evicted
+    };
+
+    std::string model;              // cache whose misses are attributed
+    uint32_t base;
+    std::vector<Counters> counters;
+
+    PcProfile(std::string model, uint32_t base, size_t instructions)
+            : model(std::move(model)), base(base), counters(instructions) {}
+
+    void record(uint32_t pc, uint64_t misses, uint64_t writebacks) {
+        uint32_t index = (pc - base) / 4;
+        if (index >= counters.size()) return;
+        Counters& c = counters[index];
+        ++c.accesses;
+        c.misses += misses;
+        c.writebacks += writebacks;
+    }
+
+    // indices of the instructions that accessed memory, most misses first (then most accesses, then pc)
+    [[nodiscard]] std::vector<uint32_t> ranked() const {
+        std::vector<uint32_t> order;
+        for (uint32_t i = 0; i < counters.size(); ++i) {
+            if (counters[i].accesses) order.push_back(i);
+        }
+        std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+            if (counters[a].misses != counters[b].misses) return counters[a].misses > counters[b].misses;
+            return counters[a].accesses > counters[b].accesses;
+        });
+        return order;
+    }
+
+    // top entries as a text table or JSON; lines maps an index to its source line (empty for machine code)
+    void write(std::ostream& out, const std::string& format, size_t top, const std::string& source,
+               const std::vector<uint32_t>& lines) const {
+        std::vector<uint32_t> order = ranked();
+        uint64_t totalMisses = 0;
+        for (const Counters& c : counters) totalMisses += c.misses;
+        if (order.size() > top) order.resize(top);
+        char buffer[256];
+        auto where = [&](uint32_t index) {
+            if (index >= lines.size()) return std::string("-");
+            return source + ":" + std::to_string(lines[index]);
+        };
+        auto rate = [](const Counters& c) { return c.accesses ? 100.0 * c.misses / c.accesses : 0.0; };
+        auto share = [&](const Counters& c) { return totalMisses ? 100.0 * c.misses / totalMisses : 0.0; };
+
+        if (format == "json") {
+            out << "{\"model\": " << jsonString(model) << ", \"misses\": " << totalMisses << ", \"instructions\": [\n";
+            for (size_t rank = 0; rank < order.size(); ++rank) {
+                uint32_t i = order[rank];
+                const Counters& c = counters[i];
+                std::snprintf(buffer, sizeof(buffer), "\"miss_rate\": %.4f, \"writebacks\": %llu, \"share\": %.4f}",
+                              rate(c), (unsigned long long)c.writebacks, share(c));
+                out << "  {\"rank\": " << rank + 1 << ", \"pc\": " << base + i * 4 << ", \"line\": " << jsonString(where(i))
+                    << ", \"accesses\": " << c.accesses << ", \"misses\": " << c.misses << ", " << buffer
+                    << (rank + 1 < order.size() ? "," : "") << "\n";
+            }
+            out << "]}\n";
+            return;
+        }
+        out << "\nmiss profile of " << model << " (" << totalMisses << " misses)\n";
+        out << "rank\tpc\tline\taccesses\tmisses\tmiss rate\twritebacks\tshare\n";
+        for (size_t rank = 0; rank < order.size(); ++rank) {
+            uint32_t i = order[rank];
+            const Counters& c = counters[i];
+            std::snprintf(buffer, sizeof(buffer), "%zu\t0x%08x\t", rank + 1, base + i * 4);
+            out << buffer << where(i);
+            std::snprintf(buffer, sizeof(buffer), "\t%llu\t%llu\t%3.4f%%\t%llu\t%3.2f%%\n", (unsigned long long)c.accesses,
+                          (unsigned long long)c.misses, rate(c), (unsigned long long)c.writebacks, share(c));
+            out << buffer;
+        }
+    }
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+#include "Parameters/CacheConfig.cpp"
+
+// Mattson stack-distance analysis for LRU with a fixed number of sets: one pass yields the hit rate
+// for every associativity. Each set numbers its accesses and keeps a Fenwick tree over those
+// timestamps with a 1 at the last access of every line, so the number of distinct lines touched
+// since a line's previous access is a prefix-sum difference.
+class StackDistance {
+public:
+    static constexpr uint64_t EMPTY = ~0ull;
+
+    struct SetState {
+        std::vector<int32_t> tree;      // Fenwick tree over timestamps, 1-based
+        std::vector<uint64_t> owner;    // timestamp -> line or EMPTY
+        uint32_t time = 0;
+        uint32_t live = 0;
+    };
+
+    uint32_t sets;
+    uint32_t offsetLen;
+    std::vector<SetState> setStates;
+    std::unordered_map<uint64_t, uint32_t> lastAccess;  // line -> timestamp in its set
+    std::vector<uint64_t> histogram;                    // distance -> count, 0 is the MRU position
+    uint64_t coldMisses = 0;
+    uint64_t accesses = 0;
+
+    StackDistance(uint32_t sets, uint32_t lineSize) : sets(sets), offsetLen(CacheConfig::log2(lineSize)),
+                                                      setStates(sets) {
+        for (auto& state : setStates) resize(state, 64);
+    }
+
+    void request(uint32_t address) {
+        uint64_t line = address >> offsetLen;
+        SetState& state = setStates[line & (sets - 1)];
+        ++accesses;
+        auto it = lastAccess.find(line);
+        if (it != lastAccess.end()) {
+            uint32_t last = it->second;
+            uint32_t distance = prefix(state, state.time) - prefix(state, last + 1);
+            if (distance >= histogram.size()) histogram.resize(distance + 1);
+            ++histogram[distance];
+            add(state, last, -1);
+            state.owner[last] = EMPTY;
+            --state.live;
+        } else {
+            ++coldMisses;
+        }
+        if (state.time == state.owner.size()) compact(state);
+        add(state, state.time, 1);
+        state.owner[state.time] = line;
+        lastAccess[line] = state.time++;
+        ++state.live;
+    }
+
+    // hits of an LRU cache with this set count and the given associativity
+    [[nodiscard]] uint64_t hits(uint32_t ways) const {
+        uint64_t sum = 0;
+        for (uint32_t d = 0; d < ways && d < histogram.size(); ++d) sum += histogram[d];
+        return sum;
+    }
+
+    void print(uint32_t lineSize) const {
+        std::printf("\nLRU miss-ratio curve (%u sets, %u-byte lines, %llu accesses, %llu cold misses)\n",
+                    sets, lineSize, (unsigned long long)accesses, (unsigned long long)coldMisses);
+        std::printf("ways\tsize\tmiss ratio\n");
+        // every associativity up to 32, then powers of two until the curve is flat
+        uint32_t maxWays = histogram.size();
+        for (uint32_t ways = 1; ; ways = ways < 32 ? ways + 1 : ways * 2) {
+            double missRatio = accesses ? 1.0 - static_cast<double>(hits(ways)) / accesses : 0.0;
+            std::printf("%u\t%llu\t%3.4f%%\n", ways, (unsigned long long)sets * ways * lineSize, missRatio * 100);
+            if (ways >= maxWays) break;
+        }
+        std::printf("\nreuse distance histogram\ndistance\taccesses\n");
+        for (uint64_t low = 0, high = 1; low < histogram.size(); low = high, high *= 2) {
+            uint64_t sum = 0;
+            for (uint64_t d = low; d < high && d < histogram.size(); ++d) sum += histogram[d];
+            if (high - low == 1) std::printf("%llu\t%llu\n", (unsigned long long)low, (unsigned long long)sum);
+            else std::printf("%llu-%llu\t%llu\n", (unsigned long long)low, (unsigned long long)high - 1,
+                             (unsigned long long)sum);
+        }
+        std::printf("cold\t%llu\n", (unsigned long long)coldMisses);
+    }
+
+private:
+    static void add(SetState& state, uint32_t time, int32_t delta) {
+        for (uint32_t i = time + 1; i < state.tree.size(); i += i & -i) state.tree[i] += delta;
+    }
+    // number of live timestamps < time
+    static uint32_t prefix(const SetState& state, uint32_t time) {
+        int32_t sum = 0;
+        for (uint32_t i = time; i > 0; i -= i & -i) sum += state.tree[i];
+        return sum;
+    }
+    static void resize(SetState& state, uint32_t capacity) {
+        state.tree.assign(capacity + 1, 0);
+        state.owner.resize(capacity, EMPTY);
+    }
+
+    // renumbers the live timestamps from 0, doubling the capacity when more than half of it is live
+    void compact(SetState& state) {
+        std::vector<uint64_t> owners;
+        owners.reserve(state.live);
+        for (uint64_t line : state.owner) {
+            if (line != EMPTY) owners.push_back(line);
+        }
+        uint32_t capacity = state.owner.size();
+        if (state.live * 2 > capacity) capacity *= 2;
+        state.owner.assign(capacity, EMPTY);
+        resize(state, capacity);
+        for (uint32_t time = 0; time < owners.size(); ++time) {
+            state.owner[time] = owners[time];
+            lastAccess[owners[time]] = time;
+            add(state, time, 1);
+        }
+        state.time = owners.size();
+    }
+};
@@ -0,0 +1,373 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Cache/CacheFactory.cpp"
+#include "Cache/CacheSimulator.cpp"
+#include "Simulator/Assembler.cpp"
+#include "Simulator/Engine.cpp"
+#include "Benchmark/Kernels.cpp"
+
+// Throughput benchmarks of the simulator's hot paths: address decoding, cache lookups and fills over
+// synthetic access streams, the assembler and both execution engines on the bundled kernels. Every
+// benchmark does a fixed amount of work per repetition and reports the best repetition, so rates are
+// comparable between builds; the checksum only depends on the work done and must match between them.
+
+struct BenchmarkResult {
+    std::string name;
+    std::string unit;               // what items counts: accesses, lines or instructions
+    uint64_t items = 0;             // per repetition
+    uint64_t checksum = 0;
+    uint32_t repetitions = 0;
+    double seconds = 0;             // best repetition
+
+    [[nodiscard]] double rate() const { return seconds > 0 ? items / seconds : 0.0; }
+};
+
+struct BenchmarkOptions {
+    std::string filter;             // substring of the names to run, empty runs all
+    double minSeconds = 0.25;       // per benchmark, repetitions continue until both limits are reached
+    uint32_t minRepetitions = 3;
+};
+
+// one repetition: returns items processed and a checksum of the result
+using BenchmarkBody = std::function<std::pair<uint64_t, uint64_t>()>;
+
+inline BenchmarkResult measure(const std::string& name, const std::string& unit, const BenchmarkBody& body,
+                               const BenchmarkOptions& options) {
+    BenchmarkResult result{name, unit};
+    double total = 0;
+    while (result.repetitions < options.minRepetitions || total < options.minSeconds) {
+        auto start = std::chrono::steady_clock::now();
+        auto [items, checksum] = body();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (result.repetitions == 0 || seconds < result.seconds) result.seconds = seconds;
+        result.items = items;
+        result.checksum = checksum;
+        total += seconds;
+        ++result.repetitions;
+    }
+    return result;
+}
+
+/*------------------------------------------ синтетические потоки ----------------------------------------------------*/
+constexpr uint32_t STREAM_LENGTH = 1u << 20;        // accesses per repetition
+constexpr uint32_t STREAM_FOOTPRINT = 1u << 20;     // bytes the streams cycle through
+constexpr uint32_t STREAM_BASE = 0x100000;
+
+// xorshift32, fixed seed so every build replays the same stream
+inline uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// sequential, strided, random and pointer-chasing address streams over STREAM_FOOTPRINT bytes
+inline std::vector<std::pair<std::string, std::vector<uint32_t>>> makeStreams(uint32_t lineSize) {
+    std::vector<std::pair<std::string, std::vector<uint32_t>>> streams;
+    std::vector<uint32_t> addresses(STREAM_LENGTH);
+
+    for (uint32_t i = 0; i < STREAM_LENGTH; ++i) addresses[i] = STREAM_BASE + i * 4 % STREAM_FOOTPRINT;
+    streams.emplace_back("sequential", addresses);
+
+    // 4 KB apart, shifted by one line per pass, so every set is hit in turn
+    for (uint32_t i = 0; i < STREAM_LENGTH; ++i) {
+        uint32_t pass = i / (STREAM_FOOTPRINT / 4096);
+        addresses[i] = STREAM_BASE + (i * 4096 + pass * lineSize) % STREAM_FOOTPRINT;
+    }
+    streams.emplace_back("strided", addresses);
+
+    uint32_t state = 0x9E3779B9;
+    for (uint32_t i = 0; i < STREAM_LENGTH; ++i) addresses[i] = STREAM_BASE + (nextRandom(state) % STREAM_FOOTPRINT & ~3u);
+    streams.emplace_back("random", addresses);
+
+    // one random cycle through all lines (Sattolo's shuffle), followed from line to line
+    uint32_t lines = STREAM_FOOTPRINT / lineSize;
+    std::vector<uint32_t> next(lines);
+    for (uint32_t i = 0; i < lines; ++i) next[i] = i;
+    for (uint32_t i = lines - 1; i > 0; --i) std::swap(next[i], next[nextRandom(state) % i]);
+    for (uint32_t i = 0, line = 0; i < STREAM_LENGTH; ++i, line = next[line]) addresses[i] = STREAM_BASE + line * lineSize;
+    streams.emplace_back("pointer_chase", addresses);
+    return streams;
+}
+
+inline CacheConfig benchmarkCache() {
+    CacheConfig config;
+    config.size = 32768;
+    config.ways = 8;
+    config.lineSize = 64;
+    config.addrLen = 32;
+    config.derive();
+    return config;
+}
+
+/*------------------------------------------------ наборы ------------------------------------------------------------*/
+inline void cacheBenchmarks(std::vector<std::pair<std::string, std::function<BenchmarkResult()>>>& suite,
+                            const BenchmarkOptions& options) {
+    const CacheConfig config = benchmarkCache();
+    auto streams = std::make_shared<std::vector<std::pair<std::string, std::vector<uint32_t>>>>(makeStreams(config.lineSize));
+
+    suite.emplace_back("decode_address", [=, &options] {
+        const std::vector<uint32_t>& addresses = (*streams)[2].second;
+        return measure("decode_address", "accesses", [&] {
+            uint64_t sum = 0;
+            for (uint32_t address : addresses) {
+                Address decoded = decodeAddress(address, config);
+                sum += decoded.a_tag ^ decoded.index ^ decoded.offset;
+            }
+            return std::make_pair(uint64_t(addresses.size()), sum);
+        }, options);
+    });
+
+    for (const PolicyInfo& info : policyRegistry()) {
+        const std::string& policy = info.key;
+
+        // isInCache over a resident working set of half the cache: every lookup hits
+        std::string name = "lookup." + policy;
+        suite.emplace_back(name, [=, &options] {
+            auto cache = makeCache(policy, config);
+            std::vector<Address> resident;
+            uint32_t state = 0x2545F491;
+            for (uint32_t i = 0; i < config.size / 2; i += config.lineSize) resident.push_back(decodeAddress(STREAM_BASE + i, config));
+            for (const Address& address : resident) cache->accessMemory(address, Type::r);
+            std::vector<Address> lookups;
+            lookups.reserve(STREAM_LENGTH);
+            for (uint32_t i = 0; i < STREAM_LENGTH; ++i) lookups.push_back(resident[nextRandom(state) % resident.size()]);
+            return measure(name, "accesses", [&] {
+                uint64_t hits = 0;
+                for (const Address& address : lookups) hits += cache->isInCache(address, Type::r);
+                return std::make_pair(uint64_t(lookups.size()), hits);
+            }, options);
+        });
+
+        // full CacheSimulator::request path: lookup, fill on a miss, eviction accounting
+        for (size_t s = 0; s < streams->size(); ++s) {
+            std::string streamName = "access." + policy + "." + (*streams)[s].first;
+            suite.emplace_back(streamName, [=, &options] {
+                const std::vector<uint32_t>& addresses = (*streams)[s].second;
+                return measure(streamName, "accesses", [&] {
+                    CacheSimulator simulator("bench", makeCache(policy, config));
+                    for (uint32_t address : addresses) simulator.request(address, Type::r);
+                    return std::make_pair(uint64_t(addresses.size()), simulator.Hits);
+                }, options);
+            });
+        }
+        // the same streams through CacheSimulator::request(AccessBatch), as the engines feed the flat models
+        for (size_t s = 0; s < streams->size(); ++s) {
+            std::string streamName = "batch." + policy + "." + (*streams)[s].first;
+            suite.emplace_back(streamName, [=, &options] {
+                const std::vector<uint32_t>& addresses = (*streams)[s].second;
+                return measure(streamName, "accesses", [&] {
+                    CacheSimulator simulator("bench", makeCache(policy, config));
+                    AccessBatch batch;
+                    for (uint32_t address : addresses) {
+                        batch.push(address, Type::r, 4, 0);
+                        if (batch.full()) {
+                            simulator.request(batch);
+                            batch.count = 0;
+                        }
+                    }
+                    simulator.request(batch);
+                    return std::make_pair(uint64_t(addresses.size()), simulator.Hits);
+                }, options);
+            });
+        }
+    }
+
+    // the same streams through an LRU cache with each prefetcher watching, accessed from one PC
+    for (const PrefetcherInfo& info : prefetcherRegistry()) {
+        for (size_t s = 0; s < streams->size(); ++s) {
+            std::string streamName = "prefetch." + info.key + "." + (*streams)[s].first;
+            suite.emplace_back(streamName, [=, &options] {
+                const std::vector<uint32_t>& addresses = (*streams)[s].second;
+                return measure(streamName, "accesses", [&] {
+                    CacheSimulator simulator("bench", makeCache("lru", config));
+                    simulator.attachPrefetcher(info.make(config, info.degree), LatencyModel());
+                    for (uint32_t address : addresses) simulator.request(address, Type::r, 0x1000);
+                    return std::make_pair(uint64_t(addresses.size()), simulator.Hits);
+                }, options);
+            });
+        }
+        // the sequential stream once more under the default geometry, whose ADDR_LEN-bit addresses wrap
+        // line numbers; every prefetcher must then still get some of its lines used
+        std::string defaultName = "prefetch." + info.key + ".sequential_default_geometry";
+        suite.emplace_back(defaultName, [=, &options] {
+            const std::vector<uint32_t>& addresses = (*streams)[0].second;
+            return measure(defaultName, "accesses", [&] {
+                CacheConfig defaults;
+                defaults.derive();
+                CacheSimulator simulator("bench", makeCache("lru", defaults));
+                simulator.attachPrefetcher(info.make(defaults, info.degree), LatencyModel());
+                for (uint32_t address : addresses) simulator.request(address, Type::r, 0x1000);
+                if (!simulator.prefetcher->useful)
+                    throw std::runtime_error(info.key + " prefetches were never used on a sequential stream");
+                return std::make_pair(uint64_t(addresses.size()), simulator.Hits);
+            }, options);
+        });
+    }
+}
+
+inline void assemblerBenchmarks(std::vector<std::pair<std::string, std::function<BenchmarkResult()>>>& suite,
+                                const BenchmarkOptions& options) {
+    suite.emplace_back("assemble", [&options] {
+        // 12.5k blocks of 8 lines: every instruction format, pseudo-instructions and labels referenced
+        // both backwards and forwards; read through parseAssembly() like a source file
+        std::string source;
+        uint64_t lines = 0;
+        for (int block = 0; block < 12500; ++block) {
+            std::string label = "L" + std::to_string(block), next = "L" + std::to_string(block + 1);
+            source += label + ": addi t0, t0, 1      # counter\n"
+                      "    lw   t1, 8(a0)\n"
+                      "    sw   t1, 12(a0)\n"
+                      "    mul  t2, t1, t0\n"
+                      "    li   t3, " + std::to_string(100000 + block) + "\n"
+                      "    beq  t0, t2, " + label + "\n"
+                      "    bne  t1, t3, " + next + "\n"
+                      "    la   a2, " + label + "\n";
+            lines += 8;
+        }
+        source += "L12500: ecall\n";
+        ++lines;
+        std::filesystem::path path = std::filesystem::temp_directory_path() / "cache_sim_bench.s";
+        std::ofstream(path, std::ios::binary) << source;
+        BenchmarkResult result = measure("assemble", "lines", [&] {
+            std::vector<uint32_t> binary;
+            Program program = parseAssembly(path.string(), binary);
+            uint64_t sum = program.code.size();
+            for (uint32_t word : binary) sum = sum * 31 + word;
+            return std::make_pair(lines, sum);
+        }, options);
+        std::filesystem::remove(path);
+        return result;
+    });
+}
+
+inline void engineBenchmarks(std::vector<std::pair<std::string, std::function<BenchmarkResult()>>>& suite,
+                             const BenchmarkOptions& options) {
+    for (const Kernel& kernel : KERNELS) {
+        for (Engine engine : {Engine::Interpreter, Engine::Block}) {
+            std::string engineKey = engine == Engine::Block ? "block" : "interp";
+            // with one cache model attached, as in a normal run; branchy makes no accesses, so it times
+            // the dispatch loop alone
+            std::string name = "execute." + std::string(kernel.name) + "." + engineKey;
+            suite.emplace_back(name, [=, &options] {
+                std::vector<uint32_t> binary;
+                Program program = assemble(kernel.name, kernel.source, binary);
+                return measure(name, "instructions", [&] {
+                    std::vector<CacheSimulator> simulators;
+                    simulators.emplace_back("bench", makeCache("lru", benchmarkCache()));
+                    Simulation simulation(std::move(simulators));
+                    program.load(simulation);
+                    run(simulation, program, engine);
+                    return std::make_pair(simulation.instructions, simulation.simulators[0].Hits * 31 +
+                                                                   static_cast<uint32_t>(simulation.getReg(11)));
+                }, options);
+            });
+        }
+    }
+    // the stream kernel driving every registered policy at once, called in turn or each on its own thread
+    for (bool pipelined : {false, true}) {
+        std::string name = std::string("fanout.") + (pipelined ? "pipelined" : "sequential");
+        suite.emplace_back(name, [=, &options] {
+            std::vector<uint32_t> binary;
+            Program program = assemble("stream", STREAM_KERNEL, binary);
+            return measure(name, "instructions", [&] {
+                std::vector<CacheSimulator> simulators;
+                for (const PolicyInfo& info : policyRegistry()) simulators.emplace_back(info.key, makeCache(info.key, benchmarkCache()));
+                Simulation simulation(std::move(simulators));
+                if (pipelined) simulation.pipeline = std::make_unique<ModelPipeline>(simulation.simulators);
+                program.load(simulation);
+                run(simulation, program, Engine::Block);
+                uint64_t hits = 0;
+                for (const CacheSimulator& simulator : simulation.simulators) hits = hits * 31 + simulator.Hits;
+                return std::make_pair(simulation.instructions, hits);
+            }, options);
+        });
+    }
+}
+
+// fixed key order and one benchmark per line, so two runs diff line by line
+inline void writeResults(std::ostream& out, const std::vector<BenchmarkResult>& results) {
+    out << "{\"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& r = results[i];
+        char rate[64], seconds[64];
+        std::snprintf(rate, sizeof(rate), "%.0f", r.rate());
+        std::snprintf(seconds, sizeof(seconds), "%.6f", r.seconds);
+        out << "  {\"name\": \"" << r.name << "\", \"unit\": \"" << r.unit << "\", \"items\": " << r.items
+            << ", \"checksum\": " << r.checksum << ", \"repetitions\": " << r.repetitions << ", \"seconds\": "
+            << seconds << ", \"rate\": " << rate << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]}\n";
+}
+
+/*--------------------------------------------------- main -----------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    std::string outFile;
+    bool list = false;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--filter") {
+                if (++i < argc) options.filter = argv[i];
+                else throw std::runtime_error("No filter specified.");
+            } else if (arg == "--min-time") {
+                if (++i < argc) options.minSeconds = std::stod(argv[i]);
+                else throw std::runtime_error("No time specified.");
+            } else if (arg == "--repetitions") {
+                if (++i < argc) options.minRepetitions = std::max(1, std::stoi(argv[i]));
+                else throw std::runtime_error("No repetition count specified.");
+            } else if (arg == "--out") {
+                if (++i < argc) outFile = argv[i];
+                else throw std::runtime_error("No output file specified.");
+            } else if (arg == "--list") {
+                list = true;
+            } else {
+                throw std::runtime_error("Unknown argument: " + arg);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error parsing command-line arguments: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::vector<std::pair<std::string, std::function<BenchmarkResult()>>> suite;
+    cacheBenchmarks(suite, options);
+    assemblerBenchmarks(suite, options);
+    engineBenchmarks(suite, options);
+
+    std::vector<BenchmarkResult> results;
+    try {
+        for (auto& [name, benchmark] : suite) {
+            if (name.find(options.filter) == std::string::npos) continue;
+            if (list) {
+                std::cout << name << "\n";
+                continue;
+            }
+            results.push_back(benchmark());
+            const BenchmarkResult& r = results.back();
+            std::fprintf(stderr, "%-32s %12.3f M%s/s\n", r.name.c_str(), r.rate() / 1e6, r.unit.c_str());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error during benchmark: " << e.what() << std::endl;
+        return 1;
+    }
+    if (list) return 0;
+
+    if (outFile.empty()) {
+        writeResults(std::cout, results);
+    } else {
+        std::ofstream out(outFile);
+        writeResults(out, results);
+    }
+    return 0;
+}
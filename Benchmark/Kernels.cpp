@@ -0,0 +1,145 @@
+#pragma once
+
+#include <string_view>
+
+// Assembly kernels bundled with the benchmark, each a few million instructions long. Data lives
+// well above the code, every kernel ends with an exit ecall.
+struct Kernel {
+    const char* name;
+    std::string_view source;
+};
+
+// fills a 64 KB array, then sums it 64 times: sequential loads that hit a cache of 64 KB or more
+inline constexpr std::string_view STREAM_KERNEL = R"(
+    li   a0, 0x100000
+    li   t0, 0
+    li   t1, 16384
+fill: sw t0, 0(a0)
+    addi a0, a0, 4
+    addi t0, t0, 1
+    blt  t0, t1, fill
+    li   s0, 0
+    li   s1, 64
+pass: li a0, 0x100000
+    li   t0, 0
+sum: lw  t2, 0(a0)
+    add  a1, a1, t2
+    addi a0, a0, 4
+    addi t0, t0, 1
+    blt  t0, t1, sum
+    addi s0, s0, 1
+    blt  s0, s1, pass
+    li   a7, 93
+    ecall
+)";
+
+// C = A * B for 64x64 word matrices: unit-stride rows of A against 256-byte-stride columns of B
+inline constexpr std::string_view MATMUL_KERNEL = R"(
+    li   s3, 64          # n
+    li   s4, 0x100000    # A
+    li   s5, 0x110000    # B
+    li   s6, 0x120000    # C
+    li   t0, 0
+    li   t1, 4096
+    mv   a0, s4
+    mv   a1, s5
+init: sw t0, 0(a0)
+    sw   t0, 0(a1)
+    addi a0, a0, 4
+    addi a1, a1, 4
+    addi t0, t0, 1
+    blt  t0, t1, init
+    li   s0, 0           # i
+row: li  s1, 0           # j
+col: li  s2, 0           # k
+    li   t6, 0
+    mul  t0, s0, s3
+    slli t0, t0, 2
+    add  a0, s4, t0      # &A[i][0]
+    slli t1, s1, 2
+    add  a1, s5, t1      # &B[0][j]
+dot: lw  t2, 0(a0)
+    lw   t3, 0(a1)
+    mul  t4, t2, t3
+    add  t6, t6, t4
+    addi a0, a0, 4
+    addi a1, a1, 256
+    addi s2, s2, 1
+    blt  s2, s3, dot
+    mul  t0, s0, s3
+    add  t0, t0, s1
+    slli t0, t0, 2
+    add  t0, s6, t0
+    sw   t6, 0(t0)
+    addi s1, s1, 1
+    blt  s1, s3, col
+    addi s0, s0, 1
+    blt  s0, s3, row
+    li   a7, 93
+    ecall
+)";
+
+// links 8192 16-byte nodes in the order of the full-period LCG i -> 5i + 1 mod 8192, then walks the
+// list 64 times: every load address depends on the previous load
+inline constexpr std::string_view LIST_KERNEL = R"(
+    li   s0, 0x200000
+    li   t0, 0
+    li   t1, 8192
+    li   t5, 8191
+link: slli t2, t0, 2
+    add  t2, t2, t0
+    addi t2, t2, 1
+    and  t2, t2, t5
+    slli t2, t2, 4
+    add  t2, t2, s0      # &node[5i + 1]
+    slli t3, t0, 4
+    add  t3, t3, s0      # &node[i]
+    sw   t2, 0(t3)
+    sw   t0, 4(t3)
+    addi t0, t0, 1
+    blt  t0, t1, link
+    li   s1, 0
+    li   s2, 64
+walk: mv a0, s0
+    li   t0, 0
+step: lw t2, 4(a0)
+    add  a1, a1, t2
+    lw   a0, 0(a0)
+    addi t0, t0, 1
+    blt  t0, t1, step
+    addi s1, s1, 1
+    blt  s1, s2, walk
+    li   a7, 93
+    ecall
+)";
+
+// Collatz trajectories of 1..9999: short blocks, data-dependent branches and no memory accesses,
+// so the run time is the dispatch loop itself
+inline constexpr std::string_view BRANCHY_KERNEL = R"(
+    li   s0, 1
+    li   s1, 10000
+    li   t0, 1
+next: mv a0, s0
+steps: beq a0, t0, done
+    andi t1, a0, 1
+    bnez t1, odd
+    srli a0, a0, 1
+    addi a1, a1, 1
+    j    steps
+odd: slli t2, a0, 1
+    add  a0, a0, t2
+    addi a0, a0, 1
+    addi a1, a1, 1
+    j    steps
+done: addi s0, s0, 1
+    blt  s0, s1, next
+    li   a7, 93
+    ecall
+)";
+
+inline constexpr Kernel KERNELS[] = {
+        {"stream", STREAM_KERNEL},
+        {"matmul", MATMUL_KERNEL},
+        {"list", LIST_KERNEL},
+        {"branchy", BRANCHY_KERNEL},
+};
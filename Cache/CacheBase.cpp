@@ -1,29 +1,156 @@
 #pragma once
 
+#include <bit>
+#include <string>
 #include <vector>
 #include "Parameters/CacheConfig.cpp"
 #include "Parameters/CommandTypes.cpp"
 #include "Entities/CacheLine.cpp"
+#include "Entities/AccessBatch.cpp"
 #include "Entities/Address.cpp"
+#include "Entities/StateStream.cpp"
+#include "Cache/TagMatch.cpp"
 
 
 class CacheBase {
 public:
-    std::vector<std::vector<CacheLine>> lines;
+    CacheConfig config;
+    std::string policy;             // registry key, set by makeCache()
+    std::vector<uint32_t> tags;     // sets * ways, the ways of a set are contiguous
+    std::vector<uint32_t> valid;    // one bit per way, one word per set
+    std::vector<uint32_t> dirty;    // one bit per way, one word per set
+    CacheLine victim{};             // what the last fill() displaced
 
-    CacheBase() {
-        lines.resize(CACHE_SETS, std::vector<CacheLine>(CACHE_WAY));
-    }
+    explicit CacheBase(const CacheConfig& config = CacheConfig())
+            : config(config), tags(config.sets * config.ways), valid(config.sets), dirty(config.sets) {}
+    virtual ~CacheBase() = default;
 
-    virtual bool accessMemory(Address address, Type type, std::vector<int8_t>& memory) {
+    virtual bool accessMemory(Address address, Type type) {
         if (isInCache(address, type)) {
             return true;
         } else {
-            updateLine(address, type, memory);
+            updateLine(address, type);
             return false;
         }
     }
 
     virtual bool isInCache(Address address, Type type) = 0;
-    virtual void updateLine(Address address, Type type, std::vector<int8_t>& memory) = 0;
+    virtual void updateLine(Address address, Type type) = 0;
+    // accessMemory() for every access of the batch, in order; implemented once per policy by CacheBatched
+    virtual void accessBatch(const AccessBatch& batch, BatchCounters& counters) = 0;
+
+    // contents plus replacement state; policies append their own arrays
+    virtual void saveState(StateWriter& out) const {
+        out.put(tags);
+        out.put(valid);
+        out.put(dirty);
+    }
+    virtual void loadState(StateReader& in) {
+        in.get(tags);
+        in.get(valid);
+        in.get(dirty);
+    }
+
+    [[nodiscard]] CacheLine line(uint32_t index, int elem) const {
+        return {static_cast<bool>(valid[index] >> elem & 1), static_cast<bool>(dirty[index] >> elem & 1),
+                tags[index * config.ways + elem]};
+    }
+
+    void fill(uint32_t index, int elem, uint32_t tag, Type type) {
+        victim = line(index, elem);
+        tags[index * config.ways + elem] = tag;
+        valid[index] |= 1u << elem;
+        if (type == Type(w)) dirty[index] |= 1u << elem;
+        else dirty[index] &= ~(1u << elem);
+    }
+
+    void touch(uint32_t index, int elem, Type type) {
+        if (type == Type(w)) dirty[index] |= 1u << elem;
+    }
+
+    // drops the line holding address and returns it (valid = false if it was not cached)
+    CacheLine invalidate(Address address) {
+        int elem = findWay(address.index, address.a_tag);
+        if (elem < 0) return {false, false, 0};
+        CacheLine old = line(address.index, elem);
+        valid[address.index] &= ~(1u << elem);
+        dirty[address.index] &= ~(1u << elem);
+        return old;
+    }
+
+    // an invalidated way is refilled before the policy's victim is evicted; cold sets are already
+    // filled in policy order, so single-level runs are unaffected
+    [[nodiscard]] int freeWayOr(uint32_t index, int elem) const {
+        uint32_t all = config.ways == 32 ? ~0u : (1u << config.ways) - 1;
+        uint32_t free = ~valid[index] & all;
+        return free && (valid[index] >> elem & 1) ? std::countr_zero(free) : elem;
+    }
+
+    // first byte of the line a tag occupies in set index
+    [[nodiscard]] uint32_t lineAddress(uint32_t tag, uint32_t index) const {
+        return static_cast<uint32_t>(uint64_t(tag) << (config.indexLen + config.offsetLen)) | (index << config.offsetLen);
+    }
+
+    // way holding the tag in the set or -1; common associativities get a fully unrolled loop
+    [[nodiscard]] int findWay(uint32_t index, uint32_t tag) const {
+        switch (config.ways) {
+            case 1: return findWayFixed<1>(index, tag);
+            case 2: return findWayFixed<2>(index, tag);
+            case 4: return findWayFixed<4>(index, tag);
+            case 8: return findWayFixed<8>(index, tag);
+            case 16: return findWayFixed<16>(index, tag);
+            case 32: return findWayFixed<32>(index, tag);
+            default: return findWayGeneric(index, tag);
+        }
+    }
+
+    template<int Ways>
+    [[nodiscard]] int findWayFixed(uint32_t index, uint32_t tag) const {
+        uint32_t match = matchTags<Ways>(&tags[index * Ways], tag) & valid[index];
+        return match ? std::countr_zero(match) : -1;
+    }
+
+    [[nodiscard]] int findWayGeneric(uint32_t index, uint32_t tag) const {
+        uint32_t match = matchTags(&tags[index * config.ways], (int)config.ways, tag) & valid[index];
+        return match ? std::countr_zero(match) : -1;
+    }
+};
+
+// Binds a policy at compile time for batched access: the loop calls the policy's isInCache() and
+// updateLine() non-virtually, so they inline, and the only virtual call is accessBatch() itself.
+// Addresses are decoded for the whole batch first, in a loop of shifts and masks the compiler vectorizes.
+template<class Policy>
+class CacheBatched : public CacheBase {
+public:
+    using CacheBase::CacheBase;
+
+    void accessBatch(const AccessBatch& batch, BatchCounters& counters) final {
+        Policy& policy = static_cast<Policy&>(*this);
+        const uint32_t offsetLen = config.offsetLen, indexShift = config.offsetLen,
+                indexMask = (1u << config.indexLen) - 1, tagShift = config.indexLen + config.offsetLen,
+                tagMask = static_cast<uint32_t>((1ull << config.tagLen) - 1);
+        std::array<uint32_t, AccessBatch::CAPACITY> tagOf, indexOf;
+        for (uint32_t i = 0; i < batch.count; ++i) {
+            tagOf[i] = batch.addresses[i] >> tagShift & tagMask;
+            indexOf[i] = batch.addresses[i] >> indexShift & indexMask;
+        }
+        auto access = [&](Address address, Type type) {
+            ++counters.requests;
+            if (policy.Policy::isInCache(address, type)) {
+                ++counters.hits;
+                return;
+            }
+            policy.Policy::updateLine(address, type);
+            if (victim.valid) {
+                ++counters.evictions;
+                counters.writebacks += victim.dirty;
+            }
+        };
+        for (uint32_t i = 0; i < batch.count; ++i) {
+            uint32_t address = batch.addresses[i];
+            access(Address(tagOf[i], indexOf[i], address & ((1u << offsetLen) - 1)), batch.types[i]);
+            uint32_t last = address + batch.sizes[i] - 1;
+            if ((last ^ address) >> offsetLen) access(decodeAddress(last, config), batch.types[i]);
+        }
+    }
 };
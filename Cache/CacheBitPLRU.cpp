@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include "Cache/CacheBase.cpp"
+
+// MRU bit per way: a hit sets it, the first clear bit is the victim; all bits set resets the others
+class CacheBitPLRU final : public CacheBatched<CacheBitPLRU> {
+public:
+    std::vector<uint32_t> plruBits;     // one bit per way, one word per set
+
+    explicit CacheBitPLRU(const CacheConfig& config = CacheConfig()) : CacheBatched(config), plruBits(config.sets) {}
+
+    bool isInCache(Address address, Type type) override {
+        int elem = findWay(address.index, address.a_tag);
+        if (elem < 0) return false;
+        touch(address.index, elem, type);
+        updateBitPLRU(address, elem);
+        return true;
+    }
+
+    void updateBitPLRU(Address address, int skip) {
+        uint32_t all = config.ways == 32 ? ~0u : (1u << config.ways) - 1;
+        plruBits[address.index] |= 1u << skip;
+        if (plruBits[address.index] == all) {
+            plruBits[address.index] = 1u << skip;
+        }
+    }
+    int findLineBitPLRU(Address address) {
+        uint32_t free = ~plruBits[address.index];
+        int ch = std::countr_zero(free);
+        return ch < (int)config.ways ? ch : 0;
+    }
+
+    void updateLine(Address address, Type type) override {
+        int newIndex = freeWayOr(address.index, findLineBitPLRU(address));
+        fill(address.index, newIndex, address.a_tag, type);
+        updateBitPLRU(address, newIndex);
+    }
+
+    void saveState(StateWriter& out) const override {
+        CacheBase::saveState(out);
+        out.put(plruBits);
+    }
+    void loadState(StateReader& in) override {
+        CacheBase::loadState(in);
+        in.get(plruBits);
+    }
+};
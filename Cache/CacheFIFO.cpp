@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include "Cache/CacheBase.cpp"
+
+// first in, first out: a round-robin pointer per set names the oldest way; hits change nothing
+class CacheFIFO final : public CacheBatched<CacheFIFO> {
+public:
+    std::vector<uint8_t> oldest;    // one byte per set
+
+    explicit CacheFIFO(const CacheConfig& config = CacheConfig()) : CacheBatched(config), oldest(config.sets) {}
+
+    bool isInCache(Address address, Type type) override {
+        int elem = findWay(address.index, address.a_tag);
+        if (elem < 0) return false;
+        touch(address.index, elem, type);
+        return true;
+    }
+
+    void updateLine(Address address, Type type) override {
+        int newIndex = freeWayOr(address.index, oldest[address.index]);
+        fill(address.index, newIndex, address.a_tag, type);
+        if (newIndex == oldest[address.index]) oldest[address.index] = (newIndex + 1) % config.ways;
+    }
+
+    void saveState(StateWriter& out) const override {
+        CacheBase::saveState(out);
+        out.put(oldest);
+    }
+    void loadState(StateReader& in) override {
+        CacheBase::loadState(in);
+        in.get(oldest);
+    }
+};
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Parameters/CacheReplacementPolicies.cpp"
+#include "Cache/CacheLRU.cpp"
+#include "Cache/CachePLRU.cpp"
+#include "Cache/CacheBitPLRU.cpp"
+#include "Cache/CacheRRIP.cpp"
+#include "Cache/CacheFIFO.cpp"
+#include "Cache/CacheRandom.cpp"
+#include "Cache/CacheLFU.cpp"
+#include "Cache/PrefetchNextLine.cpp"
+#include "Cache/PrefetchStride.cpp"
+#include "Cache/PrefetchStream.cpp"
+
+// a replacement policy selectable by name in --policies, --model, --level and sweep grids
+struct PolicyInfo {
+    std::string key;        // command-line name
+    std::string name;       // name in reports
+    std::function<std::unique_ptr<CacheBase>(const CacheConfig&)> make;
+};
+
+template<class Cache>
+std::unique_ptr<CacheBase> makePolicy(const CacheConfig& config) {
+    return std::make_unique<Cache>(config);
+}
+
+template<CacheRRIP::Insertion Insertion>
+std::unique_ptr<CacheBase> makeRRIP(const CacheConfig& config) {
+    return std::make_unique<CacheRRIP>(config, Insertion);
+}
+
+// every known policy in listing order; registerPolicy() adds more before the command line is parsed
+inline std::vector<PolicyInfo>& policyRegistry() {
+    static std::vector<PolicyInfo> registry = {
+            {"lru", "LRU", makePolicy<CacheLRU>},
+            {"plru", "pLRU", makePolicy<CachePLRU>},
+            {"bitplru", "bit-pLRU", makePolicy<CacheBitPLRU>},
+            {"srrip", "SRRIP", makeRRIP<CacheRRIP::Insertion::Static>},
+            {"brrip", "BRRIP", makeRRIP<CacheRRIP::Insertion::Bimodal>},
+            {"drrip", "DRRIP", makeRRIP<CacheRRIP::Insertion::Dynamic>},
+            {"fifo", "FIFO", makePolicy<CacheFIFO>},
+            {"random", "random", makePolicy<CacheRandom>},
+            {"lfu", "LFU", makePolicy<CacheLFU>},
+    };
+    return registry;
+}
+
+inline const PolicyInfo* lookupPolicy(const std::string& key) {
+    for (const PolicyInfo& info : policyRegistry()) {
+        if (info.key == key) return &info;
+    }
+    return nullptr;
+}
+
+inline void registerPolicy(PolicyInfo info) {
+    if (lookupPolicy(info.key)) throw std::runtime_error("Replacement policy registered twice: " + info.key);
+    policyRegistry().push_back(std::move(info));
+}
+
+inline const PolicyInfo& findPolicy(const std::string& key) {
+    if (const PolicyInfo* info = lookupPolicy(key)) return *info;
+    std::string known;
+    for (const PolicyInfo& info : policyRegistry()) known += (known.empty() ? "" : ", ") + info.key;
+    throw std::runtime_error("Unknown replacement policy: " + key + " (known: " + known + ")");
+}
+
+inline std::unique_ptr<CacheBase> makeCache(const std::string& policy, const CacheConfig& config) {
+    const PolicyInfo& info = findPolicy(policy);
+    std::unique_ptr<CacheBase> cache = info.make(config);
+    cache->policy = info.key;
+    return cache;
+}
+
+inline const std::string& policyName(const std::string& policy) {
+    return findPolicy(policy).name;
+}
+
+inline std::string parsePolicy(const std::string& name) {
+    return findPolicy(name).key;
+}
+
+// "lru,srrip,fifo" or "all"
+inline std::vector<std::string> parsePolicyList(const std::string& list) {
+    std::vector<std::string> policies;
+    if (CacheConfig::trim(list) == "all") {
+        for (const PolicyInfo& info : policyRegistry()) policies.push_back(info.key);
+        return policies;
+    }
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) policies.push_back(parsePolicy(CacheConfig::trim(item)));
+    return policies;
+}
+
+struct CacheModelSpec {
+    std::string policy = "lru";
+    CacheConfig config;
+
+    [[nodiscard]] std::string name() const {
+        return policyName(policy) + " " + std::to_string(config.size) + "B " + std::to_string(config.ways) +
+               "-way " + std::to_string(config.lineSize) + "B";
+    }
+};
+
+// "policy=plru,size=4096,ways=8,line=32"; unspecified keys keep the values of base
+inline CacheModelSpec parseModelSpec(const std::string& spec, const CacheConfig& base) {
+    CacheModelSpec model;
+    model.config = base;
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        auto eq = item.find('=');
+        if (eq == std::string::npos) throw std::runtime_error("Expected key=value in model spec: " + item);
+        std::string key = CacheConfig::trim(item.substr(0, eq)), value = CacheConfig::trim(item.substr(eq + 1));
+        if (key == "policy") model.policy = parsePolicy(value);
+        else model.config.set(key, value);
+    }
+    model.config.derive();
+    return model;
+}
+
+// a prefetcher selectable by name in --prefetch; degree is how many lines it runs ahead (buffer depth
+// for stream buffers)
+struct PrefetcherInfo {
+    std::string key;
+    uint32_t degree;        // used when the command line gives none
+    std::function<std::unique_ptr<Prefetcher>(const CacheConfig&, uint32_t)> make;
+};
+
+template<class P>
+std::unique_ptr<Prefetcher> makePrefetcherOf(const CacheConfig& config, uint32_t degree) {
+    return std::make_unique<P>(config, degree);
+}
+
+inline std::vector<PrefetcherInfo>& prefetcherRegistry() {
+    static std::vector<PrefetcherInfo> registry = {
+            {"nextline", 1, makePrefetcherOf<PrefetchNextLine>},
+            {"stride", 2, makePrefetcherOf<PrefetchStride>},
+            {"stream", 4, makePrefetcherOf<PrefetchStream>},
+    };
+    return registry;
+}
+
+inline const PrefetcherInfo& findPrefetcher(const std::string& key) {
+    for (const PrefetcherInfo& info : prefetcherRegistry()) {
+        if (info.key == key) return info;
+    }
+    std::string known;
+    for (const PrefetcherInfo& info : prefetcherRegistry()) known += (known.empty() ? "" : ", ") + info.key;
+    throw std::runtime_error("Unknown prefetcher: " + key + " (known: none, " + known + ")");
+}
+
+// "stride" or "stride:4"; "none" gives a null prefetcher
+inline std::unique_ptr<Prefetcher> makePrefetcher(const std::string& spec, const CacheConfig& config) {
+    if (spec == "none") return nullptr;
+    auto colon = spec.find(':');
+    const PrefetcherInfo& info = findPrefetcher(spec.substr(0, colon));
+    uint32_t degree = colon == std::string::npos ? info.degree : std::stoul(spec.substr(colon + 1));
+    if (degree == 0 || degree > 64) throw std::runtime_error("Prefetch degree must be in [1, 64]: " + spec);
+    return info.make(config, degree);
+}
+
+// "none,nextline,stride:4" or "all" (none and every prefetcher at its default degree); every entry
+// is checked here so mistakes surface before the run
+inline std::vector<std::string> parsePrefetcherList(const std::string& list, const CacheConfig& config) {
+    std::vector<std::string> prefetchers;
+    if (CacheConfig::trim(list) == "all") {
+        prefetchers.emplace_back("none");
+        for (const PrefetcherInfo& info : prefetcherRegistry()) prefetchers.push_back(info.key);
+        return prefetchers;
+    }
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        prefetchers.push_back(CacheConfig::trim(item));
+        makePrefetcher(prefetchers.back(), config);
+    }
+    return prefetchers;
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Cache/CacheFactory.cpp"
+#include "Analysis/MissClassifier.cpp"
+#include "Parameters/LatencyModel.cpp"
+
+// how a level relates to the contents of the levels above it
+enum class Inclusion {
+    NonInclusive,   // filled on the way up, evicts without looking above
+    Inclusive,      // filled on the way up, its evictions invalidate the copies above
+    Exclusive       // victim cache: filled only by evictions from above, a hit moves the line up
+};
+
+inline Inclusion parseInclusion(const std::string& name) {
+    if (name == "nine" || name == "non-inclusive") return Inclusion::NonInclusive;
+    if (name == "inclusive") return Inclusion::Inclusive;
+    if (name == "exclusive") return Inclusion::Exclusive;
+    throw std::runtime_error("Unknown fill mode: " + name + " (expected inclusive, exclusive or nine)");
+}
+
+inline const char* inclusionName(Inclusion inclusion) {
+    switch (inclusion) {
+        case Inclusion::Inclusive: return "inclusive";
+        case Inclusion::Exclusive: return "exclusive";
+        default: return "nine";
+    }
+}
+
+struct CacheLevelSpec {
+    std::string name;
+    CacheModelSpec model;
+    Inclusion inclusion = Inclusion::NonInclusive;
+    uint32_t latency = 0;           // lookup cycles, 0 takes LatencyModel::hit
+};
+
+// "name=L2,policy=plru,size=65536,ways=8,fill=inclusive,latency=12"; geometry keys default to base
+inline CacheLevelSpec parseLevelSpec(const std::string& spec, const CacheConfig& base) {
+    CacheLevelSpec level;
+    level.model.config = base;
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        auto eq = item.find('=');
+        if (eq == std::string::npos) throw std::runtime_error("Expected key=value in level spec: " + item);
+        std::string key = CacheConfig::trim(item.substr(0, eq)), value = CacheConfig::trim(item.substr(eq + 1));
+        if (key == "name") level.name = value;
+        else if (key == "fill") level.inclusion = parseInclusion(value);
+        else if (key == "policy") level.model.policy = parsePolicy(value);
+        else if (key == "latency") level.latency = std::stoul(value, nullptr, 0);
+        else level.model.config.set(key, value);
+    }
+    level.model.config.derive();
+    return level;
+}
+
+struct CacheLevel {
+    std::string name;
+    std::unique_ptr<CacheBase> cache;
+    std::unique_ptr<MissClassifier> classifier;     // 3C breakdown of the demand misses, off by default
+    Inclusion inclusion = Inclusion::NonInclusive;
+    uint32_t latency = 0;
+    int next = -1;                  // level that sees this one's misses and writebacks, -1 is memory
+    std::vector<int> above;         // levels whose next is this one
+    uint64_t hits = 0;              // demand accesses from the CPU or the level above
+    uint64_t misses = 0;
+    uint64_t evictions = 0;         // valid lines displaced by a fill
+    uint64_t writebacks = 0;        // dirty lines sent down
+    uint64_t backInvalidations = 0; // copies above dropped to keep an inclusive level inclusive
+
+    [[nodiscard]] double hitRate() const {
+        return hits + misses ? static_cast<double>(hits) / (hits + misses) * 100 : 0.0;
+    }
+    [[nodiscard]] uint32_t lookupCycles(const LatencyModel& model) const { return latency ? latency : model.hit; }
+};
+
+// Levels from the CPU down to memory. A level named L1I is the instruction side: it sits beside
+// the first data level and both feed the level below. Every other level feeds the next one listed.
+// A level sees only the misses (line fills) and writebacks of the levels above it.
+class CacheHierarchy {
+public:
+    std::vector<CacheLevel> levels;
+    int dataLevel = -1;
+    int instructionLevel = -1;
+    uint64_t memoryReads = 0;       // lines fetched from memory
+    uint64_t memoryWrites = 0;      // lines written back to memory
+
+    explicit CacheHierarchy(const std::vector<CacheLevelSpec>& specs) {
+        int last = -1;
+        for (const CacheLevelSpec& spec : specs) {
+            CacheLevel level;
+            level.name = spec.name.empty() ? "L" + std::to_string(levels.size() + 1) : spec.name;
+            level.cache = makeCache(spec.model.policy, spec.model.config);
+            level.inclusion = spec.inclusion;
+            level.latency = spec.latency;
+            levels.push_back(std::move(level));
+            int id = (int)levels.size() - 1;
+            if (levels[id].name == "L1I") {
+                if (instructionLevel >= 0) throw std::runtime_error("Only one L1I level is allowed");
+                instructionLevel = id;
+                continue;
+            }
+            if (last >= 0) levels[last].next = id;
+            else dataLevel = id;
+            last = id;
+        }
+        if (dataLevel < 0) throw std::runtime_error("Cache hierarchy needs a data level");
+        if (instructionLevel >= 0) levels[instructionLevel].next = levels[dataLevel].next;
+        for (int id = 0; id < (int)levels.size(); ++id) {
+            int next = levels[id].next;
+            if (next < 0) continue;
+            if (levels[next].cache->config.lineSize < levels[id].cache->config.lineSize)
+                throw std::runtime_error("Level " + levels[next].name + " has shorter lines than " + levels[id].name);
+            levels[next].above.push_back(id);
+        }
+    }
+
+    void access(int id, uint32_t address, Type type) {
+        CacheLevel& level = levels[id];
+        Address decoded = decodeAddress(address, level.cache->config);
+        bool hit = level.cache->isInCache(decoded, type);
+        if (level.classifier) level.classifier->access(address, hit);
+        if (hit) {
+            ++level.hits;
+            return;
+        }
+        ++level.misses;
+        bool dirty = fetch(level.next, address);
+        level.cache->updateLine(decoded, dirty ? Type(w) : type);
+        evict(id, decoded.index);
+    }
+
+    // data access from the CPU; one that straddles two L1D lines accesses both
+    void request(uint32_t address, Type type, uint8_t size) {
+        access(dataLevel, address, type);
+        uint32_t last = address + size - 1;
+        if ((last ^ address) >> levels[dataLevel].cache->config.offsetLen) access(dataLevel, last, type);
+    }
+
+    // Exclusive levels are skipped: their fills come from above, so a fully associative shadow of
+    // their own miss stream says nothing about them.
+    void classifyMisses() {
+        for (CacheLevel& level : levels) {
+            if (level.inclusion == Inclusion::Exclusive) continue;
+            level.classifier = std::make_unique<MissClassifier>(level.cache->config.lineCount, level.cache->config.lineSize);
+        }
+    }
+
+    // every lookup at every level pays that level's latency, every line from memory the memory latency
+    [[nodiscard]] uint64_t cycles(const LatencyModel& latency) const {
+        uint64_t sum = memoryReads * latency.memory + memoryWrites * latency.writeback;
+        for (const CacheLevel& level : levels) sum += (level.hits + level.misses) * level.lookupCycles(latency);
+        return sum;
+    }
+
+    // average over the accesses the CPU makes: the data level's and, if present, the L1I's
+    [[nodiscard]] double amat(const LatencyModel& latency) const {
+        uint64_t demand = levels[dataLevel].hits + levels[dataLevel].misses;
+        if (instructionLevel >= 0) demand += levels[instructionLevel].hits + levels[instructionLevel].misses;
+        return demand ? static_cast<double>(cycles(latency)) / demand : 0.0;
+    }
+
+    void print(const LatencyModel& latency) const {
+        for (const CacheLevel& level : levels) {
+            const CacheConfig& c = level.cache->config;
+            std::printf("%s\t%uB %u-way %uB %s %uc\thit rate: %3.4f%%\thits %llu\tmisses %llu\tevictions %llu"
+                        "\twritebacks %llu\tread %llu B\twritten %llu B", level.name.c_str(), c.size, c.ways, c.lineSize,
+                        inclusionName(level.inclusion), level.lookupCycles(latency), level.hitRate(),
+                        (unsigned long long)level.hits, (unsigned long long)level.misses,
+                        (unsigned long long)level.evictions, (unsigned long long)level.writebacks,
+                        (unsigned long long)level.misses * c.lineSize, (unsigned long long)level.writebacks * c.lineSize);
+            if (level.backInvalidations) std::printf("\tback-invalidations %llu", (unsigned long long)level.backInvalidations);
+            if (level.classifier)
+                std::printf("\tcompulsory %llu\tcapacity %llu\tconflict %llu", (unsigned long long)level.classifier->compulsory,
+                            (unsigned long long)level.classifier->capacity, (unsigned long long)level.classifier->conflict);
+            std::printf("\n");
+        }
+        std::printf("memory\treads %llu\twrites %llu\n", (unsigned long long)memoryReads,
+                    (unsigned long long)memoryWrites);
+        std::printf("latency\tAMAT %.2f cycles\tmemory cycles %llu\n", amat(latency),
+                    (unsigned long long)cycles(latency));
+    }
+
+private:
+    // line fill for the level above; returns whether the line comes up dirty (moved out of an exclusive level)
+    bool fetch(int id, uint32_t address) {
+        if (id < 0) {
+            ++memoryReads;
+            return false;
+        }
+        CacheLevel& level = levels[id];
+        if (level.inclusion != Inclusion::Exclusive) {
+            access(id, address, Type(r));
+            return false;
+        }
+        Address decoded = decodeAddress(address, level.cache->config);
+        if (level.cache->isInCache(decoded, Type(r))) {
+            ++level.hits;
+            return level.cache->invalidate(decoded).dirty;
+        }
+        ++level.misses;
+        return fetch(level.next, address);
+    }
+
+    // a line leaving the level above: a dirty writeback, or any victim when this level is exclusive
+    void install(int id, uint32_t address, bool dirty, uint32_t bytes) {
+        if (id < 0) {
+            if (dirty) ++memoryWrites;
+            return;
+        }
+        CacheLevel& level = levels[id];
+        if (!dirty && level.inclusion != Inclusion::Exclusive) return;
+        Address decoded = decodeAddress(address, level.cache->config);
+        Type type = dirty ? Type(w) : Type(r);
+        if (level.cache->isInCache(decoded, type)) return;
+        // a partial line needs the rest of it from below
+        if (bytes < level.cache->config.lineSize && fetch(level.next, address)) type = Type(w);
+        level.cache->updateLine(decoded, type);
+        evict(id, decoded.index);
+    }
+
+    // passes the victim of the last fill of a level down, dropping copies above an inclusive level first
+    void evict(int id, uint32_t index) {
+        CacheLevel& level = levels[id];
+        CacheLine victim = level.cache->victim;
+        if (!victim.valid) return;
+        ++level.evictions;
+        uint32_t address = level.cache->lineAddress(victim.l_tag, index);
+        bool dirty = victim.dirty;
+        if (level.inclusion == Inclusion::Inclusive) dirty |= invalidateAbove(id, address, level.cache->config.lineSize);
+        if (dirty) ++level.writebacks;
+        install(level.next, address, dirty, level.cache->config.lineSize);
+    }
+
+    bool invalidateAbove(int id, uint32_t address, uint32_t bytes) {
+        bool dirty = false;
+        for (int up : levels[id].above) {
+            CacheBase& cache = *levels[up].cache;
+            for (uint32_t offset = 0; offset < bytes; offset += cache.config.lineSize) {
+                CacheLine old = cache.invalidate(decodeAddress(address + offset, cache.config));
+                if (!old.valid) continue;
+                ++levels[id].backInvalidations;
+                dirty |= old.dirty;
+            }
+            dirty |= invalidateAbove(up, address, bytes);
+        }
+        return dirty;
+    }
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include "Cache/CacheBase.cpp"
+
+// least frequently used with ageing: a 4-bit use count per way (a byte each), the victim is the
+// lowest count (lowest way on ties). A count about to pass 15 halves every count of its set, so old
+// popularity decays instead of pinning lines forever.
+class CacheLFU final : public CacheBatched<CacheLFU> {
+public:
+    static constexpr uint8_t MAX_COUNT = 15;
+
+    std::vector<uint8_t> counts;    // sets * ways
+
+    explicit CacheLFU(const CacheConfig& config = CacheConfig()) : CacheBatched(config), counts(config.sets * config.ways) {}
+
+    bool isInCache(Address address, Type type) override {
+        int elem = findWay(address.index, address.a_tag);
+        if (elem < 0) return false;
+        touch(address.index, elem, type);
+        updateLFU(address.index, elem);
+        return true;
+    }
+
+    void updateLFU(uint32_t index, int elem) {
+        uint8_t* set = &counts[index * config.ways];
+        if (set[elem] == MAX_COUNT) {
+            for (uint32_t way = 0; way < config.ways; ++way) set[way] >>= 1;
+        }
+        ++set[elem];
+    }
+    int findLineLFU(uint32_t index) const {
+        const uint8_t* set = &counts[index * config.ways];
+        int victim = 0;
+        for (int way = 1; way < (int)config.ways; ++way) {
+            if (set[way] < set[victim]) victim = way;
+        }
+        return victim;
+    }
+
+    void updateLine(Address address, Type type) override {
+        int newIndex = freeWayOr(address.index, findLineLFU(address.index));
+        fill(address.index, newIndex, address.a_tag, type);
+        counts[address.index * config.ways + newIndex] = 1;
+    }
+
+    void saveState(StateWriter& out) const override {
+        CacheBase::saveState(out);
+        out.put(counts);
+    }
+    void loadState(StateReader& in) override {
+        CacheBase::loadState(in);
+        in.get(counts);
+    }
+};
@@ -1,42 +1,55 @@
+#pragma once
+
 #include <vector>
 #include "Cache/CacheBase.cpp"
-#include <list>
 
-class CacheLRU : public CacheBase {
+// age byte per way: 0 is the most recently used way, ways - 1 the victim
+class CacheLRU final : public CacheBatched<CacheLRU> {
 public:
-    std::vector<std::list<int>> lru_order;
+    std::vector<uint8_t> ages;
 
-    CacheLRU() {
-        lru_order.resize(CACHE_SETS);
-        for (int i = 0; i < CACHE_SETS; ++i) {
-            for (int j = 0; j < CACHE_WAY; ++j) {
-                lru_order[i].push_back(j);
+    explicit CacheLRU(const CacheConfig& config = CacheConfig()) : CacheBatched(config), ages(config.sets * config.ways) {
+        for (int i = 0; i < (int)config.sets; ++i) {
+            for (int j = 0; j < (int)config.ways; ++j) {
+                ages[i * config.ways + j] = j;
             }
         }
     }
 
     bool isInCache(Address address, Type type) override {
-        for (int elem = 0; elem < CACHE_WAY; ++elem) {
-            if (lines[address.index][elem].valid && lines[address.index][elem].l_tag == address.a_tag) {
-                if (type == Type(w)) { lines[address.index][elem].dirty = true; }
-                updateLRU(address.index, elem);
-                return true;
-            }
-        }
-        return false;
+        int elem = findWay(address.index, address.a_tag);
+        if (elem < 0) return false;
+        touch(address.index, elem, type);
+        updateLRU(address.index, elem);
+        return true;
     }
     void updateLRU(int index, int elem) {
-        lru_order[index].remove(elem);
-        lru_order[index].push_front(elem);
+        uint8_t* set = &ages[index * config.ways];
+        uint8_t age = set[elem];
+        for (int ch = 0; ch < (int)config.ways; ++ch) {
+            set[ch] += set[ch] < age;
+        }
+        set[elem] = 0;
     }
     int findLineLRU(int index) {
-        return lru_order[index].back();
+        const uint8_t* set = &ages[index * config.ways];
+        for (int ch = 0; ch < (int)config.ways; ++ch) {
+            if (set[ch] == config.ways - 1) return ch;
+        }
+        return 0;
     }
-    void updateLine(Address address, Type type, std::vector<int8_t>& memory) override {
-        int newIndex = findLineLRU(address.index);
-        lines[address.index][newIndex].valid = true;
-        lines[address.index][newIndex].l_tag = address.a_tag;
-        lines[address.index][newIndex].dirty = (type == Type(w));
+    void updateLine(Address address, Type type) override {
+        int newIndex = freeWayOr(address.index, findLineLRU(address.index));
+        fill(address.index, newIndex, address.a_tag, type);
         updateLRU(address.index, newIndex);
     }
-};
\ No newline at end of file
+
+    void saveState(StateWriter& out) const override {
+        CacheBase::saveState(out);
+        out.put(ages);
+    }
+    void loadState(StateReader& in) override {
+        CacheBase::loadState(in);
+        in.get(ages);
+    }
+};
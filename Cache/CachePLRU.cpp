@@ -1,52 +1,61 @@
+#pragma once
+
 #include <vector>
 #include "Cache/CacheBase.cpp"
-#include <list>
 
-class CachePLRU : public CacheBase {
+// binary-tree PLRU: ways - 1 node bits per set, node n has children 2n and 2n + 1 (root is node 1).
+// A node bit points to the half holding the next victim; an access flips the bits on its path away from it.
+class CachePLRU final : public CacheBatched<CachePLRU> {
 public:
-    CachePLRU() : CacheBase() {}
+    std::vector<uint32_t> treeBits;     // one word per set, bit n is node n
+    uint32_t levels;                    // tree depth, leaves = 2^levels >= ways
+
+    explicit CachePLRU(const CacheConfig& config = CacheConfig())
+            : CacheBatched(config), treeBits(config.sets), levels(CacheConfig::log2(std::bit_ceil(config.ways))) {}
 
     bool isInCache(Address address, Type type) override {
-        for (int elem = 0; elem < CACHE_WAY; ++elem) {
-            if (lines[address.index][elem].valid && lines[address.index][elem].l_tag == address.a_tag) {
-                if (type == Type(w)) {
-                    lines[address.index][elem].dirty = true;
-                }
-                updatePLRU(address, elem);
-                return true;
-            }
-        }
-        return false;
+        int elem = findWay(address.index, address.a_tag);
+        if (elem < 0) return false;
+        touch(address.index, elem, type);
+        updatePLRU(address, elem);
+        return true;
     }
 
-    void updatePLRU(Address address, int skip) {
-        lines[address.index][skip].PlruBits = 1;
-        int count = 0;
-        for (int ch = 0; ch < CACHE_WAY; ++ch) {
-            count += lines[address.index][ch].PlruBits;
-        }
-        if (count == CACHE_WAY) {
-            for (int ch = 0; ch < CACHE_WAY; ++ch) {
-                if (ch != skip) {
-                    lines[address.index][ch].PlruBits = 0;
-                }
-            }
+    void updatePLRU(Address address, int elem) {
+        uint32_t bits = treeBits[address.index];
+        uint32_t node = 1;
+        for (int level = (int)levels - 1; level >= 0; --level) {
+            uint32_t dir = (elem >> level) & 1;
+            bits = (bits & ~(1u << node)) | ((dir ^ 1) << node);
+            node = 2 * node + dir;
         }
+        treeBits[address.index] = bits;
     }
     int findLinePLRU(Address address) {
-        for (int ch = 0; ch < CACHE_WAY; ++ch) {
-            if (lines[address.index][ch].PlruBits == 0) {
-                return ch;
-            }
+        uint32_t bits = treeBits[address.index];
+        uint32_t node = 1, elem = 0;
+        for (int level = (int)levels - 1; level >= 0; --level) {
+            uint32_t dir = (bits >> node) & 1;
+            // with a non power of two associativity the right subtree may have no ways at all
+            if (((elem * 2 + dir) << level) >= config.ways) dir = 0;
+            elem = elem * 2 + dir;
+            node = 2 * node + dir;
         }
-        return 0;
+        return (int)elem;
     }
 
-    void updateLine(Address address, Type type, std::vector<int8_t>& memory) override {
-        int newIndex = findLinePLRU(address);
-        lines[address.index][newIndex].valid = true;
-        lines[address.index][newIndex].l_tag = address.a_tag;
-        lines[address.index][newIndex].dirty = (type == Type(w));
+    void updateLine(Address address, Type type) override {
+        int newIndex = freeWayOr(address.index, findLinePLRU(address));
+        fill(address.index, newIndex, address.a_tag, type);
         updatePLRU(address, newIndex);
     }
+
+    void saveState(StateWriter& out) const override {
+        CacheBase::saveState(out);
+        out.put(treeBits);
+    }
+    void loadState(StateReader& in) override {
+        CacheBase::loadState(in);
+        in.get(treeBits);
+    }
 };
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <vector>
+#include "Cache/CacheBase.cpp"
+
+// Re-reference interval prediction (Jaleel et al.): a 2-bit RRPV per way, packed into one word per
+// set. A hit predicts a near re-reference (0); the victim is a way predicted distant (3), after
+// ageing the whole set until one is. Insertion decides the flavour:
+//   Static   (SRRIP) inserts at 2, so a line must be reused once before it outlives a scan
+//   Bimodal  (BRRIP) inserts at 3, and at 2 for one fill in 32, which keeps thrashing working sets partly resident
+//   Dynamic  (DRRIP) duels the two: in every group of 32 sets the first always uses SRRIP and the second
+//            BRRIP, their misses steer a 10-bit saturating counter, and the other sets follow the winner
+class CacheRRIP final : public CacheBatched<CacheRRIP> {
+public:
+    enum class Insertion { Static, Bimodal, Dynamic };
+
+    static constexpr uint32_t DISTANT = 3;
+    static constexpr uint32_t LONG = 2;
+    static constexpr uint32_t BIMODAL_PERIOD = 32;     // BRRIP inserts at LONG once per period
+    static constexpr uint32_t DUEL_GROUP = 32;         // sets per pair of leader sets
+    static constexpr uint32_t PSEL_MAX = 1023;
+
+    Insertion insertion;
+    std::vector<uint64_t> rrpv;     // one word per set, way w in bits 2w and 2w + 1
+    uint32_t fills = 0;             // BRRIP throttle
+    uint32_t psel = PSEL_MAX / 2 + 1;   // DRRIP: >= half means BRRIP is missing less
+
+    CacheRRIP(const CacheConfig& config, Insertion insertion)
+            : CacheBatched(config), insertion(insertion), rrpv(config.sets, waysMask() * DISTANT) {
+        // with fewer sets every set would be a leader and none would follow the duel
+        if (insertion == Insertion::Dynamic && config.sets < 4)
+            throw std::runtime_error("DRRIP needs a cache with at least 4 sets");
+    }
+
+    bool isInCache(Address address, Type type) override {
+        int elem = findWay(address.index, address.a_tag);
+        if (elem < 0) return false;
+        touch(address.index, elem, type);
+        rrpv[address.index] &= ~(3ull << 2 * elem);
+        return true;
+    }
+
+    // first way predicted distant, ageing the set by as much as it takes to have one
+    int findLineRRIP(uint32_t index) {
+        uint64_t set = rrpv[index];
+        uint64_t distant = set & set >> 1 & waysMask();
+        if (!distant) {
+            uint32_t oldest = 0;
+            for (uint32_t way = 0; way < config.ways; ++way) oldest = std::max<uint32_t>(oldest, set >> 2 * way & 3);
+            set += waysMask() * (DISTANT - oldest);     // no field overflows: each is at most oldest
+            rrpv[index] = set;
+            distant = set & set >> 1 & waysMask();
+        }
+        return std::countr_zero(distant) / 2;
+    }
+
+    void updateLine(Address address, Type type) override {
+        int newIndex = freeWayOr(address.index, findLineRRIP(address.index));
+        fill(address.index, newIndex, address.a_tag, type);
+        uint64_t value = insertBimodal(address.index) ? (++fills % BIMODAL_PERIOD ? DISTANT : LONG) : LONG;
+        rrpv[address.index] = (rrpv[address.index] & ~(3ull << 2 * newIndex)) | value << 2 * newIndex;
+    }
+
+    void saveState(StateWriter& out) const override {
+        CacheBase::saveState(out);
+        out.put(rrpv);
+        out.put(fills);
+        out.put(psel);
+    }
+    void loadState(StateReader& in) override {
+        CacheBase::loadState(in);
+        in.get(rrpv);
+        fills = in.get<uint32_t>();
+        psel = in.get<uint32_t>();
+    }
+
+private:
+    // low bit of every way's field
+    [[nodiscard]] uint64_t waysMask() const {
+        return config.ways == 32 ? 0x5555555555555555ull : 0x5555555555555555ull & ((1ull << 2 * config.ways) - 1);
+    }
+
+    // whether a fill of this set inserts bimodally; a miss in a leader set also counts against its policy
+    bool insertBimodal(uint32_t index) {
+        if (insertion != Insertion::Dynamic) return insertion == Insertion::Bimodal;
+        uint32_t leader = index % std::min(config.sets, DUEL_GROUP);
+        if (leader == 0) {
+            psel = std::min(psel + 1, PSEL_MAX);
+            return false;
+        }
+        if (leader == 1) {
+            psel = psel ? psel - 1 : 0;
+            return true;
+        }
+        return psel > PSEL_MAX / 2;
+    }
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Cache/CacheBase.cpp"
+
+// uniformly random victim from a xorshift32 generator, one word of state for the whole cache; the
+// seed is fixed, so a run repeats exactly
+class CacheRandom final : public CacheBatched<CacheRandom> {
+public:
+    uint32_t state = 0x9E3779B9;
+
+    explicit CacheRandom(const CacheConfig& config = CacheConfig()) : CacheBatched(config) {}
+
+    bool isInCache(Address address, Type type) override {
+        int elem = findWay(address.index, address.a_tag);
+        if (elem < 0) return false;
+        touch(address.index, elem, type);
+        return true;
+    }
+
+    int findLineRandom() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return static_cast<int>(state % config.ways);
+    }
+
+    void updateLine(Address address, Type type) override {
+        int newIndex = freeWayOr(address.index, findLineRandom());
+        fill(address.index, newIndex, address.a_tag, type);
+    }
+
+    void saveState(StateWriter& out) const override {
+        CacheBase::saveState(out);
+        out.put(state);
+    }
+    void loadState(StateReader& in) override {
+        CacheBase::loadState(in);
+        state = in.get<uint32_t>();
+    }
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Cache/CacheBase.cpp"
+#include "Cache/Prefetcher.cpp"
+#include "Analysis/MissClassifier.cpp"
+#include "Parameters/LatencyModel.cpp"
+
+class CacheSimulator {
+public:
+    std::string name;
+    std::unique_ptr<CacheBase> cache;
+    std::unique_ptr<MissClassifier> classifier;     // 3C breakdown of the misses, off unless classifyMisses()
+    std::unique_ptr<Prefetcher> prefetcher;         // none unless attachPrefetcher()
+    uint64_t overallRequests = 0;
+    uint64_t Hits = 0;
+    uint64_t evictions = 0;         // valid lines displaced by a fill, prefetch fills included
+    uint64_t writebacks = 0;        // dirty ones among them, each sends a line to the next level
+    CacheSimulator(std::string name, std::unique_ptr<CacheBase> cache) : name(std::move(name)), cache(std::move(cache)) {};
+    void request(uint32_t address, Type type, uint32_t pc = 0) {
+        bool hit = cache->accessMemory(decodeAddress(address, cache->config), type);
+        ++overallRequests;
+        // a miss always fills, victim is what the fill displaced
+        if (!hit && cache->victim.valid) {
+            ++evictions;
+            if (cache->victim.dirty) ++writebacks;
+        }
+        if (prefetcher) {
+            BatchCounters counters;
+            hit = prefetcher->access(*cache, address, hit, pc, counters);
+            evictions += counters.evictions;
+            writebacks += counters.writebacks;
+        }
+        if (classifier) classifier->access(address, hit);
+        if (hit) ++Hits;
+    }
+    // an access that straddles two lines looks up both
+    void request(uint32_t address, Type type, uint8_t size, uint32_t pc) {
+        request(address, type, pc);
+        uint32_t last = address + size - 1;
+        if ((last ^ address) >> cache->config.offsetLen) request(last, type, pc);
+    }
+    // same as requesting each access in turn; one virtual call for the batch unless misses are
+    // classified or a prefetcher watches them
+    void request(const AccessBatch& batch) {
+        if (classifier || prefetcher) {
+            for (uint32_t i = 0; i < batch.count; ++i)
+                request(batch.addresses[i], batch.types[i], batch.sizes[i], batch.pcs[i]);
+            return;
+        }
+        BatchCounters counters;
+        cache->accessBatch(batch, counters);
+        overallRequests += counters.requests;
+        Hits += counters.hits;
+        evictions += counters.evictions;
+        writebacks += counters.writebacks;
+    }
+    void classifyMisses() {
+        classifier = std::make_unique<MissClassifier>(cache->config.lineCount, cache->config.lineSize);
+    }
+    // the report names the prefetcher after the cache; lateness is judged against the memory latency
+    void attachPrefetcher(std::unique_ptr<Prefetcher> attached, const LatencyModel& latency) {
+        prefetcher = std::move(attached);
+        prefetcher->setLatency(latency);
+        name += " + " + prefetcher->name;
+    }
+    [[nodiscard]] double hitRate() const {
+        return static_cast<double>(Hits) / overallRequests * 100;
+    }
+    [[nodiscard]] uint64_t misses() const { return overallRequests - Hits; }
+    // traffic to and from the next level, whole lines (write-back, write-allocate); prefetches read
+    // too, but only misses stall
+    [[nodiscard]] uint64_t bytesRead() const {
+        return (misses() + (prefetcher ? prefetcher->issued : 0)) * cache->config.lineSize;
+    }
+    [[nodiscard]] uint64_t bytesWritten() const { return writebacks * cache->config.lineSize; }
+    [[nodiscard]] uint64_t cycles(const LatencyModel& latency) const {
+        return overallRequests * latency.hit + misses() * latency.memory + writebacks * latency.writeback;
+    }
+    // average memory access time in cycles
+    [[nodiscard]] double amat(const LatencyModel& latency) const {
+        return overallRequests ? static_cast<double>(cycles(latency)) / overallRequests : 0.0;
+    }
+
+    void print(const LatencyModel& latency) const {
+        std::printf("%s\thit rate: %3.4f%%\tmisses %llu\tevictions %llu\twritebacks %llu\tread %llu B\twritten %llu B"
+                    "\tAMAT %.2f cycles\tmemory cycles %llu", name.c_str(), hitRate(), (unsigned long long)misses(),
+                    (unsigned long long)evictions, (unsigned long long)writebacks, (unsigned long long)bytesRead(),
+                    (unsigned long long)bytesWritten(), amat(latency), (unsigned long long)cycles(latency));
+        if (classifier)
+            std::printf("\tcompulsory %llu\tcapacity %llu\tconflict %llu", (unsigned long long)classifier->compulsory,
+                        (unsigned long long)classifier->capacity, (unsigned long long)classifier->conflict);
+        if (prefetcher)
+            std::printf("\tprefetches %llu\tuseful %llu\taccuracy %.2f%%\tcoverage %.2f%%\tlate %llu\tunused %llu"
+                        "\tpollution %llu", (unsigned long long)prefetcher->issued, (unsigned long long)prefetcher->useful,
+                        prefetcher->accuracy(), prefetcher->coverage(misses()), (unsigned long long)prefetcher->late,
+                        (unsigned long long)prefetcher->unused, (unsigned long long)prefetcher->pollution);
+        std::printf("\n");
+    }
+};
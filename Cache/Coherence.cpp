@@ -0,0 +1,228 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Cache/CacheFactory.cpp"
+
+// Private L1 data caches of several harts kept coherent with MESI by a directory, over a shared L2
+// (write-back, write-allocate, not inclusive). The directory knows every line held by an L1: the
+// harts sharing it and the one holding it exclusively (E or M). A read miss downgrades an exclusive
+// copy to S, a modified one supplying the data and writing it back to the L2 on the way; a write miss
+// or a write hit in S invalidates all other copies, a modified copy moving to the writer.
+//
+// Each hart remembers the lines it lost to invalidations and which words other harts have written
+// since. A miss on such a line is a coherence miss: true sharing when it touches one of those words,
+// false sharing when it only shares the line with them.
+class CoherentCaches {
+public:
+    static constexpr uint32_t MAX_HARTS = 64;
+
+    struct HartStats {
+        uint64_t accesses = 0;
+        uint64_t hits = 0;
+        uint64_t coherenceMisses = 0;   // on lines lost to another hart's write
+        uint64_t trueSharing = 0;
+        uint64_t falseSharing = 0;
+        uint64_t invalidations = 0;     // copies other harts' writes took away
+        uint64_t writebacks = 0;        // dirty lines this L1 wrote to the L2
+    };
+
+    std::vector<std::unique_ptr<CacheBase>> l1;
+    std::unique_ptr<CacheBase> l2;
+    std::string l1Name, l2Name;
+    std::vector<HartStats> stats;
+    uint64_t invalidations = 0;         // copies invalidated
+    uint64_t upgrades = 0;              // write hits in S
+    uint64_t interventions = 0;         // misses served by the modified copy of another L1
+    uint64_t l2Accesses = 0;
+    uint64_t l2Hits = 0;
+    uint64_t l2Writebacks = 0;          // dirty lines the L2 wrote to memory
+
+    CoherentCaches(uint32_t harts, const CacheModelSpec& l1Spec, const CacheModelSpec& l2Spec)
+            : l1Name(l1Spec.name()), l2Name(l2Spec.name()), stats(harts), state(harts), stale(harts) {
+        if (harts == 0 || harts > MAX_HARTS) throw std::runtime_error("Hart count must be in [1, 64]");
+        if (l1Spec.config.lineSize > 256) throw std::runtime_error("Coherent L1 lines must be at most 256 bytes");
+        if (l2Spec.config.lineSize != l1Spec.config.lineSize) throw std::runtime_error("L1 and L2 lines must be the same size");
+        for (uint32_t h = 0; h < harts; ++h) {
+            l1.push_back(makeCache(l1Spec.policy, l1Spec.config));
+            state[h].assign(l1Spec.config.sets * l1Spec.config.ways, INVALID);
+        }
+        l2 = makeCache(l2Spec.policy, l2Spec.config);
+    }
+
+    // one load or store of a hart; an access that crosses a line boundary looks up both lines
+    void access(uint32_t hart, uint32_t address, Type type, uint8_t size) {
+        const CacheConfig& config = l1[hart]->config;
+        uint32_t last = address + size - 1;
+        if (!((last ^ address) >> config.offsetLen)) return lineAccess(hart, address, type, words(address, last));
+        uint32_t split = last & ~((1u << config.offsetLen) - 1);
+        lineAccess(hart, address, type, words(address, split - 1));
+        lineAccess(hart, split, type, words(split, last));
+    }
+
+    void print(const std::vector<uint64_t>& instructions) const {
+        for (uint32_t h = 0; h < stats.size(); ++h) {
+            const HartStats& s = stats[h];
+            std::printf("hart %u\tinstructions %llu\tL1 hit rate: %3.4f%%\tmisses %llu\tcoherence misses %llu\t"
+                        "true sharing %llu\tfalse sharing %llu\tinvalidations %llu\twritebacks %llu\n", h,
+                        (unsigned long long)instructions[h], s.accesses ? 100.0 * s.hits / s.accesses : 0.0,
+                        (unsigned long long)(s.accesses - s.hits), (unsigned long long)s.coherenceMisses,
+                        (unsigned long long)s.trueSharing, (unsigned long long)s.falseSharing,
+                        (unsigned long long)s.invalidations, (unsigned long long)s.writebacks);
+        }
+        std::printf("L1\t%s\n", l1Name.c_str());
+        std::printf("L2 %s\thit rate: %3.4f%%\taccesses %llu\tmisses %llu\twritebacks %llu\n", l2Name.c_str(),
+                    l2Accesses ? 100.0 * l2Hits / l2Accesses : 0.0, (unsigned long long)l2Accesses,
+                    (unsigned long long)(l2Accesses - l2Hits), (unsigned long long)l2Writebacks);
+        std::printf("coherence\tinvalidations %llu\tupgrades %llu\tinterventions %llu\n",
+                    (unsigned long long)invalidations, (unsigned long long)upgrades, (unsigned long long)interventions);
+    }
+
+private:
+    // MESI state of an L1 way, plus WATCH while other harts hold stale copies of its line, so writes
+    // that hit in M still reach the stale copies' word masks
+    enum : uint8_t { INVALID, SHARED, EXCLUSIVE, MODIFIED, STATE = 3, WATCH = 4 };
+
+    struct DirEntry {
+        uint64_t sharers = 0;       // harts holding the line, the exclusive one included
+        uint64_t stale = 0;         // harts that lost it to an invalidation and have not missed on it since
+        int32_t owner = -1;         // hart holding it in E or M
+    };
+
+    std::vector<std::vector<uint8_t>> state;                        // per hart, sets * ways
+    std::unordered_map<uint32_t, DirEntry> directory;               // line address -> entry, held or stale lines only
+    std::vector<std::unordered_map<uint32_t, uint64_t>> stale;      // per hart: lost line -> words written since
+
+    [[nodiscard]] uint64_t words(uint32_t first, uint32_t last) const {
+        uint32_t mask = l1[0]->config.lineSize - 1, low = (first & mask) >> 2, high = (last & mask) >> 2;
+        return (high == 63 ? ~0ull : (1ull << (high + 1)) - 1) & ~((1ull << low) - 1);
+    }
+
+    uint8_t& wayState(uint32_t hart, Address address) {
+        int way = l1[hart]->findWay(address.index, address.a_tag);
+        return state[hart][address.index * l1[hart]->config.ways + way];
+    }
+
+    void l2Access(uint32_t address, Type type) {
+        ++l2Accesses;
+        if (l2->accessMemory(decodeAddress(address, l2->config), type)) ++l2Hits;
+        else if (l2->victim.valid && l2->victim.dirty) ++l2Writebacks;
+    }
+
+    // records a write of hart to words of line in the word masks of every stale copy
+    void noteWrite(uint32_t hart, const DirEntry& entry, uint32_t line, uint64_t written) {
+        for (uint64_t others = entry.stale & ~(1ull << hart); others; others &= others - 1)
+            stale[std::countr_zero(others)][line] |= written;
+    }
+
+    // takes the line away from every hart but the writer; a modified copy is handed to the writer
+    void invalidateOthers(uint32_t hart, DirEntry& entry, uint32_t line) {
+        Address address = decodeAddress(line, l1[hart]->config);
+        for (uint64_t others = entry.sharers & ~(1ull << hart); others; others &= others - 1) {
+            uint32_t other = std::countr_zero(others);
+            CacheLine old = l1[other]->invalidate(address);
+            if (old.dirty) ++interventions;
+            ++stats[other].invalidations;
+            ++invalidations;
+            stale[other].try_emplace(line, 0);
+            entry.stale |= 1ull << other;
+        }
+        entry.sharers &= 1ull << hart;
+        entry.owner = -1;
+    }
+
+    void lineAccess(uint32_t hart, uint32_t address, Type type, uint64_t touched) {
+        CacheBase& cache = *l1[hart];
+        const uint64_t self = 1ull << hart;
+        uint32_t line = address & ~((1u << cache.config.offsetLen) - 1) &
+                        static_cast<uint32_t>((1ull << cache.config.addrLen) - 1);
+        Address decoded = decodeAddress(line, cache.config);
+        HartStats& s = stats[hart];
+        ++s.accesses;
+
+        if (cache.isInCache(decoded, type)) {
+            ++s.hits;
+            if (type != Type(w)) return;
+            uint8_t& way = wayState(hart, decoded);
+            if ((way & STATE) == SHARED) {
+                ++upgrades;
+                DirEntry& entry = directory[line];
+                invalidateOthers(hart, entry, line);
+                entry.owner = static_cast<int32_t>(hart);
+                noteWrite(hart, entry, line, touched);
+                way = MODIFIED | (entry.stale & ~self ? WATCH : 0);
+            } else {
+                if (way & WATCH) {
+                    DirEntry& entry = directory[line];
+                    noteWrite(hart, entry, line, touched);
+                    if (!(entry.stale & ~self)) way &= ~WATCH;
+                }
+                way = (way & WATCH) | MODIFIED;
+            }
+            return;
+        }
+
+        DirEntry& entry = directory[line];
+        if (auto lost = stale[hart].find(line); lost != stale[hart].end()) {
+            ++s.coherenceMisses;
+            if (lost->second & touched) ++s.trueSharing;
+            else ++s.falseSharing;
+            stale[hart].erase(lost);
+            entry.stale &= ~self;
+        }
+        bool fromPeer = false;
+        uint8_t granted;
+        if (type == Type(w)) {
+            if (entry.owner >= 0) fromPeer = l1[entry.owner]->line(decoded.index, findOwnerWay(entry, decoded)).dirty;
+            invalidateOthers(hart, entry, line);
+            entry.owner = static_cast<int32_t>(hart);
+            noteWrite(hart, entry, line, touched);
+            granted = MODIFIED;
+        } else {
+            if (entry.owner >= 0) {
+                uint32_t owner = entry.owner;
+                uint8_t& ownerWay = wayState(owner, decoded);
+                if ((ownerWay & STATE) == MODIFIED) {
+                    // the owner supplies the line and writes it back
+                    fromPeer = true;
+                    ++interventions;
+                    ++stats[owner].writebacks;
+                    l2Access(line, Type::w);
+                    l1[owner]->dirty[decoded.index] &= ~(1u << findOwnerWay(entry, decoded));
+                }
+                ownerWay = SHARED;
+                entry.owner = -1;
+            }
+            granted = entry.sharers ? SHARED : EXCLUSIVE;
+            if (granted == EXCLUSIVE) entry.owner = static_cast<int32_t>(hart);
+        }
+        if (!fromPeer) l2Access(line, Type::r);
+        entry.sharers |= self;
+
+        cache.updateLine(decoded, type);
+        if (cache.victim.valid) evict(hart, cache.lineAddress(cache.victim.l_tag, decoded.index), cache.victim.dirty);
+        wayState(hart, decoded) = granted | (entry.stale & ~self ? WATCH : 0);
+    }
+
+    [[nodiscard]] int findOwnerWay(const DirEntry& entry, Address address) const {
+        return l1[entry.owner]->findWay(address.index, address.a_tag);
+    }
+
+    void evict(uint32_t hart, uint32_t line, bool dirty) {
+        if (dirty) {
+            ++stats[hart].writebacks;
+            l2Access(line, Type::w);
+        }
+        auto it = directory.find(line);
+        if (it == directory.end()) return;
+        it->second.sharers &= ~(1ull << hart);
+        if (it->second.owner == static_cast<int32_t>(hart)) it->second.owner = -1;
+        if (!it->second.sharers && !it->second.stale) directory.erase(it);
+    }
+};
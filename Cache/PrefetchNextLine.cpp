@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "Cache/Prefetcher.cpp"
+
+// tagged next-line prefetch (Smith): a miss, or the first use of a prefetched line, fetches the
+// following degree lines, so a sequential walk stays ahead after a single miss
+class PrefetchNextLine final : public Prefetcher {
+public:
+    PrefetchNextLine(const CacheConfig& config, uint32_t degree)
+            : Prefetcher("next-line prefetch, degree " + std::to_string(degree), config), degree(degree) {}
+
+protected:
+    void train(uint32_t, uint32_t address, PrefetchTrigger trigger) override {
+        if (trigger == PrefetchTrigger::Hit) return;
+        uint32_t line = address >> config.offsetLen;
+        for (uint32_t k = 1; k <= degree; ++k) candidates.push_back(line + k);
+    }
+
+private:
+    uint32_t degree;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Cache/Prefetcher.cpp"
+
+// Stream buffers (Jouppi): FIFOs of the lines following a miss, held beside the cache rather than in
+// it, so they cannot pollute it. A miss that finds its line in a buffer takes it from there, drops
+// the lines ahead of it and the buffer fetches more to stay depth lines deep; a miss no buffer holds
+// restarts the least recently used buffer at the next line.
+class PrefetchStream final : public Prefetcher {
+public:
+    static constexpr uint32_t BUFFERS = 4;
+
+    PrefetchStream(const CacheConfig& config, uint32_t depth)
+            : Prefetcher(std::to_string(BUFFERS) + " stream buffers, depth " + std::to_string(depth), config),
+              depth(depth), buffers(BUFFERS), issuedAt(BUFFERS * depth) {}
+
+    void saveState(StateWriter& out) const override {
+        Prefetcher::saveState(out);
+        out.put(buffers);
+        out.put(issuedAt);
+    }
+    void loadState(StateReader& in) override {
+        Prefetcher::loadState(in);
+        in.get(buffers);
+        in.get(issuedAt);
+    }
+
+protected:
+    void train(uint32_t, uint32_t address, PrefetchTrigger trigger) override {
+        if (trigger != PrefetchTrigger::Miss) return;
+        auto lru = std::min_element(buffers.begin(), buffers.end(),
+                                    [](const Buffer& a, const Buffer& b) { return a.lastUse < b.lastUse; });
+        unused += lru->count;
+        *lru = {((address >> config.offsetLen) + 1) & lineMask, 0, clock};
+        refill(static_cast<uint32_t>(lru - buffers.begin()));
+    }
+
+    bool supply(uint32_t line) override {
+        for (uint32_t b = 0; b < BUFFERS; ++b) {
+            Buffer& buffer = buffers[b];
+            uint32_t position = (line - buffer.head) & lineMask;
+            if (position >= buffer.count) continue;
+            uint64_t* times = &issuedAt[b * depth];
+            used(times[position]);
+            unused += position;
+            std::copy(times + position + 1, times + buffer.count, times);
+            buffer.head = (line + 1) & lineMask;
+            buffer.count -= position + 1;
+            buffer.lastUse = clock;
+            refill(b);
+            return true;
+        }
+        return false;
+    }
+
+private:
+    struct Buffer {
+        uint32_t head;          // line at the front, masked like supply()'s; the buffer holds head .. head + count - 1
+        uint32_t count;
+        uint64_t lastUse;
+    };
+
+    uint32_t depth;
+    std::vector<Buffer> buffers;
+    std::vector<uint64_t> issuedAt;     // per buffer, depth issue times in FIFO order
+
+    void refill(uint32_t b) {
+        Buffer& buffer = buffers[b];
+        std::fill(issuedAt.begin() + b * depth + buffer.count, issuedAt.begin() + (b + 1) * depth, clock);
+        issued += depth - buffer.count;
+        buffer.count = depth;
+    }
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Cache/Prefetcher.cpp"
+
+// PC-indexed stride prefetch (Chen and Baer's reference prediction table): a direct-mapped table keyed
+// by the load or store's PC holds its last address, the stride between its last two addresses and a
+// 2-bit confidence. Every access of the instruction trains its entry; from confidence 2 on it fetches
+// the lines degree strides ahead, or the next degree lines when the stride is shorter than a line.
+class PrefetchStride final : public Prefetcher {
+public:
+    static constexpr uint32_t ENTRIES = 256;
+
+    PrefetchStride(const CacheConfig& config, uint32_t degree)
+            : Prefetcher("stride prefetch, degree " + std::to_string(degree), config), degree(degree), table(ENTRIES) {}
+
+    void saveState(StateWriter& out) const override {
+        Prefetcher::saveState(out);
+        out.put(table);
+    }
+    void loadState(StateReader& in) override {
+        Prefetcher::loadState(in);
+        in.get(table);
+    }
+
+protected:
+    void train(uint32_t pc, uint32_t address, PrefetchTrigger) override {
+        Entry& entry = table[(pc >> 2) & (ENTRIES - 1)];
+        if (entry.pc != pc) {
+            entry = {pc, address, 0, 0};
+            return;
+        }
+        auto stride = static_cast<int32_t>(address - entry.last);
+        entry.last = address;
+        if (stride == 0) return;
+        if (stride == entry.stride) {
+            if (entry.confidence < 3) ++entry.confidence;
+        } else if (entry.confidence > 0) {
+            --entry.confidence;
+        } else {
+            entry.stride = stride;
+        }
+        // only a delta that confirms the learned stride prefetches; a stray one just costs confidence
+        if (stride != entry.stride || entry.confidence < 2) return;
+        int64_t step = stride;
+        if ((step < 0 ? -step : step) < config.lineSize) {
+            uint32_t line = address >> config.offsetLen;
+            for (uint32_t k = 1; k <= degree; ++k) candidates.push_back(step < 0 ? line - k : line + k);
+        } else {
+            for (uint32_t k = 1; k <= degree; ++k)
+                candidates.push_back(static_cast<uint32_t>(address + step * k) >> config.offsetLen);
+        }
+    }
+
+private:
+    struct Entry {
+        uint32_t pc;
+        uint32_t last;          // address of the latest access
+        int32_t stride;
+        uint32_t confidence;    // 0-3
+    };
+
+    uint32_t degree;
+    std::vector<Entry> table;
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "Cache/CacheBase.cpp"
+#include "Parameters/LatencyModel.cpp"
+
+// what a demand access told the prefetcher
+enum class PrefetchTrigger {
+    Miss,           // the line had to come from memory
+    PrefetchHit,    // first use of a prefetched line
+    Hit,
+};
+
+// A hardware prefetcher between CacheSimulator and its cache. It watches every demand lookup and
+// fetches the lines it predicts into the cache like a miss would (the policy places them as it places
+// demand fills), or, for stream buffers, into storage of its own that demand misses are served from.
+//
+// Prefetched ways stay tagged until their first demand hit, so the report can say how good the
+// predictions were: accuracy is the share of prefetches used before eviction, coverage the share of
+// would-be misses they removed, a late prefetch was first used within a memory latency of its issue
+// (counting one demand access per hit latency), so the access still partly waited for it, and
+// pollution counts demand misses on lines a prefetch had evicted.
+class Prefetcher {
+public:
+    std::string name;
+    uint64_t issued = 0;        // lines fetched from memory by the prefetcher
+    uint64_t useful = 0;        // prefetched lines a demand access used
+    uint64_t late = 0;          // useful ones used within lateWindow accesses of their issue
+    uint64_t unused = 0;        // prefetched lines evicted or dropped before any use
+    uint64_t pollution = 0;     // demand misses on lines a prefetch displaced
+    uint64_t lateWindow;        // demand accesses a fill from memory takes
+
+    Prefetcher(std::string name, const CacheConfig& config)
+            : name(std::move(name)), lateWindow(LatencyModel().memory), config(config),
+              lineMask(static_cast<uint32_t>((1ull << (config.addrLen - config.offsetLen)) - 1)),
+              prefetched(config.sets), issuedAt(config.sets * config.ways) {}
+    virtual ~Prefetcher() = default;
+
+    void setLatency(const LatencyModel& latency) { lateWindow = latency.memory / std::max(1u, latency.hit); }
+
+    // One demand lookup of address, after the cache answered hit (and filled the line on a miss).
+    // Returns whether the access was served without waiting for memory; victims of prefetch fills
+    // are added to counters.
+    bool access(CacheBase& cache, uint32_t address, bool hit, uint32_t pc, BatchCounters& counters) {
+        ++clock;
+        uint32_t line = address >> config.offsetLen & lineMask;
+        Address decoded = decodeAddress(address, config);
+        uint32_t bit = 1u << cache.findWay(decoded.index, decoded.a_tag);
+        uint32_t& tagged = prefetched[decoded.index];
+        PrefetchTrigger trigger = PrefetchTrigger::Hit;
+        if (hit) {
+            if (tagged & bit) {
+                tagged &= ~bit;
+                used(issuedAt[decoded.index * config.ways + std::countr_zero(bit)]);
+                trigger = PrefetchTrigger::PrefetchHit;
+            }
+        } else {
+            // the demand fill took this way; a tag still on it belonged to the line it displaced
+            if (tagged & bit) ++unused;
+            tagged &= ~bit;
+            if (displaced.erase(line)) ++pollution;
+            if (supply(line)) {
+                hit = true;
+                trigger = PrefetchTrigger::PrefetchHit;
+            } else {
+                trigger = PrefetchTrigger::Miss;
+            }
+        }
+        candidates.clear();
+        train(pc, address, trigger);
+        for (uint32_t candidate : candidates) fill(cache, candidate & lineMask, counters);
+        return hit;
+    }
+
+    [[nodiscard]] double accuracy() const { return issued ? 100.0 * useful / issued : 0.0; }
+    // misses is what remained with the prefetcher, so misses + useful is what there would have been
+    [[nodiscard]] double coverage(uint64_t misses) const {
+        return misses + useful ? 100.0 * useful / (misses + useful) : 0.0;
+    }
+
+    // tags and the displaced lines; prefetchers append their own tables
+    virtual void saveState(StateWriter& out) const {
+        out.put(prefetched);
+        out.put(issuedAt);
+        out.put(clock);
+        out.put(static_cast<uint32_t>(displaced.size()));
+        for (uint32_t line : displaced) out.put(line);
+    }
+    virtual void loadState(StateReader& in) {
+        in.get(prefetched);
+        in.get(issuedAt);
+        clock = in.get<uint64_t>();
+        displaced.clear();
+        for (uint32_t count = in.get<uint32_t>(); count > 0; --count) displaced.insert(in.get<uint32_t>());
+    }
+
+protected:
+    CacheConfig config;
+    uint64_t clock = 0;                 // demand accesses so far
+    std::vector<uint32_t> candidates;   // lines train() wants in the cache
+    uint32_t lineMask;                  // line numbers wrap at addrLen bits, as supply() receives them
+
+    // learns from one demand access (trigger as seen after supply()) and appends lines to candidates
+    virtual void train(uint32_t pc, uint32_t address, PrefetchTrigger trigger) = 0;
+    // a demand miss on line: true when the prefetcher holds the line itself and hands it over
+    virtual bool supply(uint32_t) { return false; }
+
+    // a prefetched line issued at the given clock was used by the current access
+    void used(uint64_t issue) {
+        ++useful;
+        if (clock - issue <= lateWindow) ++late;
+    }
+
+private:
+    std::vector<uint32_t> prefetched;   // one bit per way: filled by a prefetch and not used yet
+    std::vector<uint64_t> issuedAt;     // clock at each way's prefetch, sets * ways
+    std::unordered_set<uint32_t> displaced;     // lines prefetch fills evicted and no fill has brought back
+
+    void fill(CacheBase& cache, uint32_t line, BatchCounters& counters) {
+        Address decoded = decodeAddress(line << config.offsetLen, config);
+        if (cache.findWay(decoded.index, decoded.a_tag) >= 0) return;
+        ++issued;
+        cache.updateLine(decoded, Type::r);
+        int way = cache.findWay(decoded.index, decoded.a_tag);
+        uint32_t bit = 1u << way;
+        if (cache.victim.valid) {
+            ++counters.evictions;
+            counters.writebacks += cache.victim.dirty;
+            if (prefetched[decoded.index] & bit) ++unused;
+            else displaced.insert(cache.lineAddress(cache.victim.l_tag, decoded.index) >> config.offsetLen & lineMask);
+        }
+        prefetched[decoded.index] |= bit;
+        issuedAt[decoded.index * config.ways + way] = clock;
+        displaced.erase(line);
+    }
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// bit i of the result is set when set[i] == tag; compares 8 (AVX2) or 4 (SSE2) ways per instruction
+
+inline uint32_t matchTags4(const uint32_t* set, uint32_t tag) {
+#if defined(__SSE2__)
+    __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(set)), _mm_set1_epi32((int)tag));
+    return static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(eq)));
+#else
+    uint32_t match = 0;
+    for (int elem = 0; elem < 4; ++elem) match |= static_cast<uint32_t>(set[elem] == tag) << elem;
+    return match;
+#endif
+}
+
+inline uint32_t matchTags8(const uint32_t* set, uint32_t tag) {
+#if defined(__AVX2__)
+    __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(set)),
+                                    _mm256_set1_epi32((int)tag));
+    return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(eq)));
+#else
+    return matchTags4(set, tag) | matchTags4(set + 4, tag) << 4;
+#endif
+}
+
+template<int Ways>
+inline uint32_t matchTags(const uint32_t* set, uint32_t tag) {
+    if constexpr (Ways % 8 == 0) {
+        uint32_t match = 0;
+        for (int elem = 0; elem < Ways; elem += 8) match |= matchTags8(set + elem, tag) << elem;
+        return match;
+    } else if constexpr (Ways == 4) {
+        return matchTags4(set, tag);
+    } else {
+        uint32_t match = 0;
+        for (int elem = 0; elem < Ways; ++elem) match |= static_cast<uint32_t>(set[elem] == tag) << elem;
+        return match;
+    }
+}
+
+inline uint32_t matchTags(const uint32_t* set, int ways, uint32_t tag) {
+    uint32_t match = 0;
+    int elem = 0;
+    for (; elem + 8 <= ways; elem += 8) match |= matchTags8(set + elem, tag) << elem;
+    for (; elem + 4 <= ways; elem += 4) match |= matchTags4(set + elem, tag) << elem;
+    for (; elem < ways; ++elem) match |= static_cast<uint32_t>(set[elem] == tag) << elem;
+    return match;
+}
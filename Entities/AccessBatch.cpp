@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include "Parameters/CommandTypes.cpp"
+
+// Accesses queued for the flat cache models, stored as parallel arrays so a model can decode all
+// addresses in one vectorizable pass before walking its sets.
+struct AccessBatch {
+    static constexpr uint32_t CAPACITY = 256;
+
+    std::array<uint32_t, CAPACITY> addresses;
+    std::array<Type, CAPACITY> types;
+    std::array<uint8_t, CAPACITY> sizes;    // bytes, an access may straddle two lines
+    std::array<uint32_t, CAPACITY> pcs;     // of the load or store, for prefetchers that learn per instruction
+    uint32_t count = 0;
+
+    void push(uint32_t address, Type type, uint8_t size, uint32_t pc) {
+        addresses[count] = address;
+        types[count] = type;
+        sizes[count] = size;
+        pcs[count] = pc;
+        ++count;
+    }
+    [[nodiscard]] bool full() const { return count == CAPACITY; }
+};
+
+// what a batch did to one model
+struct BatchCounters {
+    uint64_t requests = 0;          // line lookups, two for a line-crossing access
+    uint64_t hits = 0;
+    uint64_t evictions = 0;
+    uint64_t writebacks = 0;
+};
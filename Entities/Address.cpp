@@ -1,9 +1,19 @@
+#pragma once
+
 #include <cstdint>
+#include "Parameters/CacheConfig.cpp"
 
 struct Address {
-    uint16_t a_tag;     // CACHE_TAG_LEN
-    uint8_t index;      // CACHE_INDEX_LEN
-    uint8_t offset;     // CACHE_OFFSET_LEN
+    uint32_t a_tag;     // tagLen bits
+    uint32_t index;     // indexLen bits
+    uint32_t offset;    // offsetLen bits
 
-    Address(uint16_t tag, uint8_t idx, uint8_t offst) : a_tag(tag), index(idx), offset(offst) {};
+    Address(uint32_t tag, uint32_t idx, uint32_t offst) : a_tag(tag), index(idx), offset(offst) {};
 };
+
+inline Address decodeAddress(uint32_t address, const CacheConfig& config) {
+    uint32_t tag = (address >> (config.indexLen + config.offsetLen)) & ((1ull << config.tagLen) - 1);
+    uint32_t index = (address >> config.offsetLen) & ((1u << config.indexLen) - 1);
+    uint32_t offset = address & ((1u << config.offsetLen) - 1);
+    return {tag, index, offset};
+}
@@ -1,9 +1,10 @@
+#pragma once
+
 #include <cstdint>
 
-struct CacheLine {  // 3 flags + tag + data
+struct CacheLine {  // snapshot of one way: 2 flags + tag
     bool valid;
     bool dirty;
-    int PlruBits;
 
-    uint16_t l_tag;    // uint16_t because CACHE_TAG_LEN = 9 bits;
+    uint32_t l_tag;
 };
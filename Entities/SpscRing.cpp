@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Bounded lock-free queue between exactly one producer and one consumer thread. Slots are filled and
+// drained in place: the producer writes into reserve() and publishes it, the consumer reads front()
+// and pops it. Head and tail sit on their own cache lines, and each side keeps a copy of the other's
+// index so it touches the shared one only when the ring looks full or empty. A side with nothing to
+// do can block in one of the wait functions (std::atomic::wait on a flag of its own) instead of
+// spinning. pop() wakes a waiting producer; a waiting consumer sleeps until the producer calls
+// wake(), so it can be woken once per several slots rather than for every one.
+template<class T, size_t Capacity>
+class SpscRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // producer: slot to fill, nullptr while the ring is full
+    T* reserve() {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - headCache == Capacity) {
+            headCache = head.load(std::memory_order_acquire);
+            if (t - headCache == Capacity) return nullptr;
+        }
+        return &slots[t & (Capacity - 1)];
+    }
+    void publish() { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+    // producer: wakes the consumer if it sleeps in waitForData()
+    void wake() { rouse(consumerSleeps); }
+    // producer: blocks while the ring is full
+    void waitForRoom() {
+        size_t t = tail.load(std::memory_order_relaxed);
+        sleepUntil(producerSleeps, [&] { return t - head.load(std::memory_order_acquire) != Capacity; });
+    }
+    // producer: blocks until the consumer has popped everything published
+    void waitUntilEmpty() {
+        wake();
+        size_t t = tail.load(std::memory_order_relaxed);
+        sleepUntil(producerSleeps, [&] { return head.load(std::memory_order_acquire) == t; });
+    }
+
+    // consumer: oldest published slot, nullptr while the ring is empty
+    T* front() {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tailCache) {
+            tailCache = tail.load(std::memory_order_acquire);
+            if (h == tailCache) return nullptr;
+        }
+        return &slots[h & (Capacity - 1)];
+    }
+    // releases the slot, so whatever the consumer did with it is visible to a thread that sees the ring empty
+    void pop() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        rouse(producerSleeps);
+    }
+    // consumer: blocks until wake() finds the ring no longer empty
+    void waitForData() {
+        size_t h = head.load(std::memory_order_relaxed);
+        sleepUntil(consumerSleeps, [&] { return tail.load(std::memory_order_acquire) != h; });
+    }
+
+    // either side; true once the consumer has popped everything published
+    [[nodiscard]] bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+private:
+    alignas(64) std::atomic<size_t> head{0};    // next slot to read, written by the consumer
+    size_t tailCache = 0;                       // consumer's copy of tail
+    alignas(64) std::atomic<size_t> tail{0};    // next slot to write, written by the producer
+    size_t headCache = 0;                       // producer's copy of head
+    alignas(64) std::atomic<uint32_t> consumerSleeps{0};    // 1 while the consumer waits in waitForData()
+    std::atomic<uint32_t> producerSleeps{0};                // 1 while the producer waits for the consumer
+    alignas(64) std::array<T, Capacity> slots;
+
+    // Sleeps on flag until ready() holds. The flag goes up before the last check and the waker moves an
+    // index before reading the flag, with a full fence on both sides, so either the sleeper sees the
+    // new index or the waker sees the flag: a wake-up cannot fall between check and sleep.
+    template<class Ready>
+    static void sleepUntil(std::atomic<uint32_t>& flag, Ready ready) {
+        while (!ready()) {
+            flag.store(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (ready()) {
+                flag.store(0, std::memory_order_relaxed);
+                return;
+            }
+            flag.wait(1, std::memory_order_acquire);
+        }
+    }
+    // the waking side: after an index store, wakes a sleeper without a system call when there is none
+    static void rouse(std::atomic<uint32_t>& flag) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (flag.load(std::memory_order_relaxed) && flag.exchange(0, std::memory_order_relaxed)) flag.notify_one();
+    }
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Little-endian byte image of simulator state, used by checkpoints. Vectors are stored with their
+// length; reading one back requires the destination to already have that length, so state is only
+// ever restored into a model of the same shape.
+class StateWriter {
+public:
+    std::vector<uint8_t> bytes;
+
+    template<class T>
+    void put(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        append(&value, sizeof(T));
+    }
+    template<class T>
+    void put(const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        put(static_cast<uint32_t>(values.size()));
+        append(values.data(), values.size() * sizeof(T));
+    }
+    void put(const std::string& text) {
+        put(static_cast<uint32_t>(text.size()));
+        append(text.data(), text.size());
+    }
+    void append(const void* data, size_t size) {
+        const auto* p = static_cast<const uint8_t*>(data);
+        bytes.insert(bytes.end(), p, p + size);
+    }
+};
+
+class StateReader {
+public:
+    StateReader(const uint8_t* data, size_t size) : pos(data), end(data + size) {}
+
+    template<class T>
+    T get() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value;
+        copy(&value, sizeof(T));
+        return value;
+    }
+    template<class T>
+    void get(std::vector<T>& values) {
+        if (get<uint32_t>() != values.size()) throw std::runtime_error("Checkpoint state does not match the model");
+        copy(values.data(), values.size() * sizeof(T));
+    }
+    std::string getString() {
+        std::string text(get<uint32_t>(), '\0');
+        copy(text.data(), text.size());
+        return text;
+    }
+    void copy(void* out, size_t size) {
+        if (static_cast<size_t>(end - pos) < size) throw std::runtime_error("Truncated checkpoint");
+        std::memcpy(out, pos, size);
+        pos += size;
+    }
+    [[nodiscard]] bool atEnd() const { return pos == end; }
+
+private:
+    const uint8_t* pos;
+    const uint8_t* end;
+};
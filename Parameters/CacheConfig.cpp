@@ -1,4 +1,11 @@
-constexpr int MEM_SIZE = 262144;        // bytes
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+// default geometry (the original course assignment), overridable at runtime
 constexpr int CACHE_SIZE = 2048;        // bytes
 constexpr int CACHE_LINE_SIZE = 64;     // bytes
 constexpr int CACHE_LINE_COUNT = 32;
@@ -8,3 +15,68 @@ constexpr int ADDR_LEN = 18;            // bits
 constexpr int CACHE_TAG_LEN = 9;        // bits
 constexpr int CACHE_INDEX_LEN = 3;      // bits
 constexpr int CACHE_OFFSET_LEN = 6;     // bits
+
+struct CacheConfig {
+    uint32_t size = CACHE_SIZE;         // bytes
+    uint32_t lineSize = CACHE_LINE_SIZE;// bytes
+    uint32_t ways = CACHE_WAY;
+    uint32_t addrLen = ADDR_LEN;        // bits
+
+    // derived by derive()
+    uint32_t sets = CACHE_SETS;
+    uint32_t lineCount = CACHE_LINE_COUNT;
+    uint32_t tagLen = CACHE_TAG_LEN;
+    uint32_t indexLen = CACHE_INDEX_LEN;
+    uint32_t offsetLen = CACHE_OFFSET_LEN;
+
+    static bool isPowerOfTwo(uint32_t x) { return x != 0 && (x & (x - 1)) == 0; }
+    static uint32_t log2(uint32_t x) {
+        uint32_t bits = 0;
+        while (x >>= 1) ++bits;
+        return bits;
+    }
+
+    void derive() {
+        if (!isPowerOfTwo(lineSize)) throw std::runtime_error("Cache line size must be a power of two");
+        if (ways == 0 || ways > 32) throw std::runtime_error("Cache associativity must be in [1, 32]");
+        if (size == 0 || size % (lineSize * ways) != 0)
+            throw std::runtime_error("Cache size must be a multiple of line size * associativity");
+        if (addrLen == 0 || addrLen > 32) throw std::runtime_error("Address length must be in [1, 32] bits");
+        lineCount = size / lineSize;
+        sets = lineCount / ways;
+        if (!isPowerOfTwo(sets)) throw std::runtime_error("Number of cache sets must be a power of two");
+        offsetLen = log2(lineSize);
+        indexLen = log2(sets);
+        if (offsetLen + indexLen > addrLen) throw std::runtime_error("Address is too short for this cache geometry");
+        tagLen = addrLen - indexLen - offsetLen;
+    }
+
+    // keys: size, ways, line, addr (same names as in the config file)
+    void set(const std::string& key, const std::string& value) {
+        uint32_t v = std::stoul(value, nullptr, 0);
+        if (key == "size") size = v;
+        else if (key == "ways") ways = v;
+        else if (key == "line") lineSize = v;
+        else if (key == "addr") addrLen = v;
+        else throw std::runtime_error("Unknown cache parameter: " + key);
+    }
+
+    // "key = value" per line, '#' starts a comment
+    void load(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) throw std::runtime_error("Cannot open config file: " + path);
+        std::string line;
+        while (std::getline(file, line)) {
+            line = line.substr(0, line.find('#'));
+            auto eq = line.find('=');
+            if (eq == std::string::npos) continue;
+            set(trim(line.substr(0, eq)), trim(line.substr(eq + 1)));
+        }
+    }
+
+    static std::string trim(const std::string& s) {
+        auto begin = s.find_first_not_of(" \t\r");
+        if (begin == std::string::npos) return "";
+        return s.substr(begin, s.find_last_not_of(" \t\r") - begin + 1);
+    }
+};
@@ -1,5 +1,19 @@
+#pragma once
+
+// numbering of --replacement; every policy, these included, is also selectable by name (CacheFactory.cpp)
 enum ReplacementPolicy {
     ALL,
     LRU,
-    PLRU
+    PLRU,       // tree pseudo-LRU
+    BIT_PLRU    // MRU-bit pseudo-LRU
 };
+
+// registry name of a numbered policy (ALL has none)
+inline const char* policyKey(ReplacementPolicy policy) {
+    switch (policy) {
+        case LRU: return "lru";
+        case PLRU: return "plru";
+        case BIT_PLRU: return "bitplru";
+        default: return "";
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "Parameters/CacheConfig.cpp"
+
+// cycle costs that turn hit, miss and writeback counts into memory time
+struct LatencyModel {
+    uint32_t hit = 1;           // lookup of a flat model, and of a hierarchy level that sets no latency
+    uint32_t memory = 100;      // line fill from memory
+    uint32_t writeback = 0;     // dirty line written to memory; 0 models a write buffer that hides it
+
+    void set(const std::string& key, const std::string& value) {
+        uint32_t v = std::stoul(value, nullptr, 0);
+        if (key == "hit") hit = v;
+        else if (key == "memory") memory = v;
+        else if (key == "writeback") writeback = v;
+        else throw std::runtime_error("Unknown latency parameter: " + key);
+    }
+
+    // "hit=1,memory=200,writeback=20"; unspecified keys keep their defaults
+    static LatencyModel parse(const std::string& spec) {
+        LatencyModel model;
+        std::stringstream ss(spec);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            auto eq = item.find('=');
+            if (eq == std::string::npos) throw std::runtime_error("Expected key=value in latency spec: " + item);
+            model.set(CacheConfig::trim(item.substr(0, eq)), CacheConfig::trim(item.substr(eq + 1)));
+        }
+        return model;
+    }
+};
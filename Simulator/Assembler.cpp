@@ -0,0 +1,501 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Simulator/Encoder.cpp"
+#include "Simulator/Program.cpp"
+#include "Trace/MappedFile.cpp"
+
+
+/*----------------------------- некоторые необходимые значения -------------------------------------------------------*/
+// operand layout of a mnemonic as written in the source
+enum class Syntax : uint8_t {
+    Reg3,           // rd, rs1, rs2
+    RegImm,         // rd, rs1, imm
+    Load,           // rd, imm(rs1)
+    Store,          // rs2, imm(rs1)
+    Branch,         // rs1, rs2, pc-relative offset | label
+    Upper,          // rd, imm20
+    Jal,            // [rd,] absolute target | label
+    Jalr,           // rd, rs1, imm | rd, imm(rs1) | rs1
+    None,           // fence, ecall, ebreak
+    // pseudo-instructions
+    Nop, Mv, Li, La, J, Jr, Ret, BranchZero
+};
+
+struct Mnemonic {
+    Opcode op = Opcode::ILLEGAL;
+    Syntax syntax = Syntax::None;
+};
+
+// up to 8 characters packed little-endian into one word, 0 for anything longer
+constexpr uint64_t packName(std::string_view name) {
+    if (name.empty() || name.size() > 8) return 0;
+    uint64_t key = 0;
+    for (size_t i = 0; i < name.size(); ++i) key |= static_cast<uint64_t>(static_cast<uint8_t>(name[i])) << (8 * i);
+    return key;
+}
+
+// Compile-time open-addressed table keyed by packed names: a lookup is one multiply and, in practice,
+// a single 64-bit compare.
+template<class Value, size_t N>
+class NameTable {
+    static_assert(std::has_single_bit(N));
+    struct Slot {
+        uint64_t key = 0;
+        Value value{};
+    };
+    std::array<Slot, N> slots{};
+
+    static constexpr size_t home(uint64_t key) {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> (64 - std::countr_zero(N)));
+    }
+
+public:
+    struct Entry {
+        std::string_view name;
+        Value value;
+    };
+
+    template<size_t M>
+    constexpr explicit NameTable(const Entry (&entries)[M]) {
+        static_assert(M < N);
+        for (const Entry& entry : entries) {
+            uint64_t key = packName(entry.name);
+            size_t i = home(key);
+            while (slots[i].key != 0) i = (i + 1) & (N - 1);
+            slots[i] = {key, entry.value};
+        }
+    }
+
+    constexpr const Value* find(std::string_view name) const {
+        uint64_t key = packName(name);
+        if (key == 0) return nullptr;
+        for (size_t i = home(key);; i = (i + 1) & (N - 1)) {
+            if (slots[i].key == key) return &slots[i].value;
+            if (slots[i].key == 0) return nullptr;
+        }
+    }
+};
+
+inline constexpr NameTable<uint8_t, 128> registerTable({
+        {"zero", 0}, {"ra", 1}, {"sp", 2}, {"gp", 3}, {"tp", 4}, {"t0", 5}, {"t1", 6}, {"t2", 7},
+        {"s0", 8}, {"fp", 8}, {"s1", 9}, {"a0", 10}, {"a1", 11}, {"a2", 12}, {"a3", 13}, {"a4", 14}, {"a5", 15},
+        {"a6", 16}, {"a7", 17}, {"s2", 18}, {"s3", 19}, {"s4", 20}, {"s5", 21}, {"s6", 22}, {"s7", 23},
+        {"s8", 24}, {"s9", 25}, {"s10", 26}, {"s11", 27}, {"t3", 28}, {"t4", 29}, {"t5", 30}, {"t6", 31},
+        {"x0", 0}, {"x1", 1}, {"x2", 2}, {"x3", 3}, {"x4", 4}, {"x5", 5}, {"x6", 6}, {"x7", 7},
+        {"x8", 8}, {"x9", 9}, {"x10", 10}, {"x11", 11}, {"x12", 12}, {"x13", 13}, {"x14", 14}, {"x15", 15},
+        {"x16", 16}, {"x17", 17}, {"x18", 18}, {"x19", 19}, {"x20", 20}, {"x21", 21}, {"x22", 22}, {"x23", 23},
+        {"x24", 24}, {"x25", 25}, {"x26", 26}, {"x27", 27}, {"x28", 28}, {"x29", 29}, {"x30", 30}, {"x31", 31}
+});
+
+inline constexpr NameTable<Mnemonic, 128> mnemonicTable({
+        // R
+        {"add",  {Opcode::ADD, Syntax::Reg3}},  {"sub",  {Opcode::SUB, Syntax::Reg3}},
+        {"sll",  {Opcode::SLL, Syntax::Reg3}},  {"slt",  {Opcode::SLT, Syntax::Reg3}},
+        {"sltu", {Opcode::SLTU, Syntax::Reg3}}, {"xor",  {Opcode::XOR, Syntax::Reg3}},
+        {"srl",  {Opcode::SRL, Syntax::Reg3}},  {"sra",  {Opcode::SRA, Syntax::Reg3}},
+        {"or",   {Opcode::OR, Syntax::Reg3}},   {"and",  {Opcode::AND, Syntax::Reg3}},
+        {"mul",  {Opcode::MUL, Syntax::Reg3}},  {"mulh", {Opcode::MULH, Syntax::Reg3}},
+        {"mulhsu", {Opcode::MULHSU, Syntax::Reg3}}, {"mulhu", {Opcode::MULHU, Syntax::Reg3}},
+        {"div",  {Opcode::DIV, Syntax::Reg3}},  {"divu", {Opcode::DIVU, Syntax::Reg3}},
+        {"rem",  {Opcode::REM, Syntax::Reg3}},  {"remu", {Opcode::REMU, Syntax::Reg3}},
+        // I
+        {"addi", {Opcode::ADDI, Syntax::RegImm}}, {"slti",  {Opcode::SLTI, Syntax::RegImm}},
+        {"sltiu", {Opcode::SLTIU, Syntax::RegImm}}, {"xori", {Opcode::XORI, Syntax::RegImm}},
+        {"ori",  {Opcode::ORI, Syntax::RegImm}},  {"andi",  {Opcode::ANDI, Syntax::RegImm}},
+        {"slli", {Opcode::SLLI, Syntax::RegImm}}, {"srli",  {Opcode::SRLI, Syntax::RegImm}},
+        {"srai", {Opcode::SRAI, Syntax::RegImm}}, {"jalr",  {Opcode::JALR, Syntax::Jalr}},
+        {"lb",   {Opcode::LB, Syntax::Load}},     {"lh",    {Opcode::LH, Syntax::Load}},
+        {"lw",   {Opcode::LW, Syntax::Load}},     {"lbu",   {Opcode::LBU, Syntax::Load}},
+        {"lhu",  {Opcode::LHU, Syntax::Load}},
+        // S
+        {"sb",   {Opcode::SB, Syntax::Store}},    {"sh",    {Opcode::SH, Syntax::Store}},
+        {"sw",   {Opcode::SW, Syntax::Store}},
+        // B
+        {"beq",  {Opcode::BEQ, Syntax::Branch}},  {"bne",   {Opcode::BNE, Syntax::Branch}},
+        {"blt",  {Opcode::BLT, Syntax::Branch}},  {"bge",   {Opcode::BGE, Syntax::Branch}},
+        {"bltu", {Opcode::BLTU, Syntax::Branch}}, {"bgeu",  {Opcode::BGEU, Syntax::Branch}},
+        // U, J
+        {"lui",  {Opcode::LUI, Syntax::Upper}},   {"auipc", {Opcode::AUIPC, Syntax::Upper}},
+        {"jal",  {Opcode::JAL, Syntax::Jal}},
+        // system
+        {"fence", {Opcode::FENCE, Syntax::None}}, {"ecall", {Opcode::ECALL, Syntax::None}},
+        {"ebreak", {Opcode::EBREAK, Syntax::None}},
+        // pseudo
+        {"nop",  {Opcode::ADDI, Syntax::Nop}},    {"mv",    {Opcode::ADDI, Syntax::Mv}},
+        {"li",   {Opcode::ADDI, Syntax::Li}},     {"la",    {Opcode::AUIPC, Syntax::La}},
+        {"j",    {Opcode::JAL, Syntax::J}},       {"jr",    {Opcode::JALR, Syntax::Jr}},
+        {"ret",  {Opcode::JALR, Syntax::Ret}},
+        {"beqz", {Opcode::BEQ, Syntax::BranchZero}}, {"bnez", {Opcode::BNE, Syntax::BranchZero}}
+});
+
+
+/*------------------------------------------ разбор строк ------------------------------------------------------------*/
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+inline bool isNumber(std::string_view token) {
+    size_t i = (!token.empty() && (token[0] == '-' || token[0] == '+')) ? 1 : 0;
+    return i < token.size() && token[i] >= '0' && token[i] <= '9';
+}
+
+// decimal or 0x-prefixed hexadecimal, optionally signed; values wrap to 32 bits
+inline bool parseNumber(std::string_view token, int64_t& value) {
+    bool negative = false;
+    if (!token.empty() && (token[0] == '-' || token[0] == '+')) {
+        negative = token[0] == '-';
+        token.remove_prefix(1);
+    }
+    int base = 10;
+    if (token.size() > 2 && token[0] == '0' && (token[1] == 'x' || token[1] == 'X')) {
+        base = 16;
+        token.remove_prefix(2);
+    }
+    uint64_t magnitude = 0;
+    auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), magnitude, base);
+    if (token.empty() || error != std::errc() || end != token.data() + token.size()) return false;
+    value = negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+    return true;
+}
+
+// one instruction line after the first pass: operands still point into the mapped source
+struct Statement {
+    Mnemonic mnemonic;
+    uint8_t count = 0;
+    uint32_t line = 0;
+    uint32_t address = 0;
+    std::string_view operands[3];
+};
+
+// li fits in addi, lui, or lui + addi
+inline bool splitUpper(int32_t value, int32_t& upper, int32_t& lower) {
+    lower = static_cast<int32_t>(static_cast<uint32_t>(value) << 20) >> 20;
+    upper = static_cast<int32_t>(static_cast<uint32_t>(value) - static_cast<uint32_t>(lower));
+    return upper != 0 && lower != 0;
+}
+
+
+/*--------------------------------------- работа с ассемблером -------------------------------------------------------*/
+// Two-pass assembler over a memory-mapped source. The first pass tokenizes every line once into
+// string_views and records label addresses; the second resolves operands and emits each predecoded
+// Instruction together with its encoding.
+class Assembler {
+public:
+    std::vector<Instruction> code;
+    std::vector<uint32_t> binary;
+    std::vector<uint32_t> lines;    // source line of each code entry
+
+    Assembler(std::string path, std::string_view source) : path(std::move(path)) {
+        scan(source);
+        code.reserve(size / 4);
+        binary.reserve(size / 4);
+        lines.reserve(size / 4);
+        for (const Statement& statement : statements) emit(statement);
+    }
+
+private:
+    std::string path;
+    std::vector<Statement> statements;
+    std::unordered_map<std::string_view, uint32_t> labels;
+    uint32_t size = 0;              // bytes of code
+    const Statement* current = nullptr;
+
+    [[noreturn]] void fail(uint32_t line, const std::string& message) const {
+        throw std::runtime_error(path + ":" + std::to_string(line) + ": " + message);
+    }
+
+    // bytes a statement assembles to, known in the first pass so labels get their final address
+    uint32_t length(const Statement& statement) const {
+        if (statement.mnemonic.syntax == Syntax::La) return 8;
+        if (statement.mnemonic.syntax == Syntax::Li && statement.count == 2) {
+            int64_t value;
+            int32_t upper, lower;
+            if (!parseNumber(statement.operands[1], value)) fail(statement.line, "li expects a number");
+            return splitUpper(static_cast<int32_t>(value), upper, lower) ? 8 : 4;
+        }
+        return 4;
+    }
+
+    void scan(std::string_view source) {
+        uint32_t lineNumber = 0;
+        while (!source.empty()) {
+            size_t end = source.find('\n');
+            std::string_view line = source.substr(0, end);
+            source.remove_prefix(end == std::string_view::npos ? source.size() : end + 1);
+            ++lineNumber;
+
+            line = line.substr(0, line.find('#'));
+            size_t i = 0;
+            auto skipSpace = [&] { while (i < line.size() && isSpace(line[i])) ++i; };
+            auto token = [&] {
+                size_t begin = i;
+                while (i < line.size() && !isSpace(line[i]) && line[i] != ',' && line[i] != ':') ++i;
+                return line.substr(begin, i - begin);
+            };
+
+            skipSpace();
+            std::string_view name = token();
+            while (i < line.size() && line[i] == ':') {
+                if (name.empty()) fail(lineNumber, "empty label");
+                if (!labels.emplace(name, size).second) fail(lineNumber, "duplicate label " + std::string(name));
+                ++i;
+                skipSpace();
+                name = token();
+            }
+            if (name.empty() || name[0] == '.') continue;
+
+            const Mnemonic* mnemonic = mnemonicTable.find(name);
+            if (!mnemonic) {
+                std::cerr << path << ":" << lineNumber << ": Unrecognized instruction mnemonic: " << name << std::endl;
+                continue;
+            }
+
+            Statement statement;
+            statement.mnemonic = *mnemonic;
+            statement.line = lineNumber;
+            statement.address = size;
+            for (skipSpace(); i < line.size(); skipSpace()) {
+                if (line[i] == ',') {
+                    ++i;
+                    continue;
+                }
+                if (statement.count == 3) fail(lineNumber, "too many operands");
+                statement.operands[statement.count++] = token();
+                if (i < line.size() && line[i] == ':') fail(lineNumber, "unexpected ':'");
+            }
+            size += length(statement);
+            statements.push_back(statement);
+        }
+    }
+
+    uint8_t reg(std::string_view name) const {
+        const uint8_t* index = registerTable.find(name);
+        if (!index) fail(current->line, "unknown register '" + std::string(name) + "'");
+        return *index;
+    }
+
+    int32_t number(std::string_view token) const {
+        int64_t value;
+        if (!parseNumber(token, value)) fail(current->line, "bad immediate '" + std::string(token) + "'");
+        return static_cast<int32_t>(value);
+    }
+
+    // absolute address of a label, or of a number taken relative to `relative`
+    int32_t target(std::string_view token, uint32_t relative) const {
+        if (isNumber(token)) return static_cast<int32_t>(relative + number(token));
+        auto label = labels.find(token);
+        if (label == labels.end()) fail(current->line, "undefined label '" + std::string(token) + "'");
+        return static_cast<int32_t>(label->second);
+    }
+
+    // "imm(reg)" -> {imm, reg}; a bare "(reg)" has offset 0
+    std::pair<int32_t, uint8_t> memoryOperand(std::string_view token) const {
+        size_t open = token.find('(');
+        if (open == std::string_view::npos || token.back() != ')') fail(current->line, "expected imm(reg)");
+        std::string_view offset = token.substr(0, open);
+        return {offset.empty() ? 0 : number(offset), reg(token.substr(open + 1, token.size() - open - 2))};
+    }
+
+    void expect(uint8_t count) const {
+        if (current->count != count)
+            fail(current->line, "expected " + std::to_string(count) + " operands, got " + std::to_string(current->count));
+    }
+
+    // immediates and offsets must fit their field, the encoder would silently truncate them
+    void checkRange(const Instruction& in, uint32_t address) const {
+        int64_t value = in.imm;
+        int bits;
+        switch (encodingOf(in.op).format) {
+            case Format::I:
+            case Format::S:
+                bits = 12;
+                break;
+            case Format::Shift:
+                if (value < 0 || value > 31) fail(current->line, "shift amount " + std::to_string(value) + " out of range");
+                return;
+            case Format::B:
+                value -= address;
+                bits = 13;
+                break;
+            case Format::J:
+                value -= address;
+                bits = 21;
+                break;
+            default:
+                return;
+        }
+        if (value < -(int64_t(1) << (bits - 1)) || value >= (int64_t(1) << (bits - 1)))
+            fail(current->line, "immediate " + std::to_string(value) + " out of range");
+        if (bits > 12 && (value & 1)) fail(current->line, "misaligned jump offset " + std::to_string(value));
+    }
+
+    void push(const Instruction& in, uint32_t address) {
+        code.push_back(in);
+        binary.push_back(encodeInstruction(in, address));
+        lines.push_back(current->line);
+    }
+
+    void emit(const Statement& statement) {
+        current = &statement;
+        const std::string_view* operands = statement.operands;
+        const uint32_t address = statement.address;
+        Instruction in;
+        in.op = statement.mnemonic.op;
+        switch (statement.mnemonic.syntax) {
+            case Syntax::Reg3:
+                expect(3);
+                in.rd = reg(operands[0]);
+                in.rs1 = reg(operands[1]);
+                in.rs2 = reg(operands[2]);
+                break;
+            case Syntax::RegImm:
+                expect(3);
+                in.rd = reg(operands[0]);
+                in.rs1 = reg(operands[1]);
+                in.imm = number(operands[2]);
+                break;
+            case Syntax::Load:
+                in.rd = reg(operands[0]);
+                if (statement.count == 3) {
+                    in.imm = number(operands[1]);
+                    in.rs1 = reg(operands[2]);
+                } else {
+                    expect(2);
+                    std::tie(in.imm, in.rs1) = memoryOperand(operands[1]);
+                }
+                break;
+            case Syntax::Store:
+                in.rs2 = reg(operands[0]);
+                if (statement.count == 3) {
+                    in.imm = number(operands[1]);
+                    in.rs1 = reg(operands[2]);
+                } else {
+                    expect(2);
+                    std::tie(in.imm, in.rs1) = memoryOperand(operands[1]);
+                }
+                break;
+            case Syntax::Branch:
+                expect(3);
+                in.rs1 = reg(operands[0]);
+                in.rs2 = reg(operands[1]);
+                in.imm = target(operands[2], address);
+                break;
+            case Syntax::BranchZero:
+                expect(2);
+                in.rs1 = reg(operands[0]);
+                in.imm = target(operands[1], address);
+                break;
+            case Syntax::Upper:
+                expect(2);
+                in.rd = reg(operands[0]);
+                in.imm = static_cast<int32_t>(static_cast<uint32_t>(number(operands[1])) << 12);
+                if (in.op == Opcode::AUIPC) in.imm += static_cast<int32_t>(address);
+                break;
+            case Syntax::Jal:
+                if (statement.count == 1) {
+                    in.rd = 1;
+                    in.imm = target(operands[0], 0);
+                } else {
+                    expect(2);
+                    in.rd = reg(operands[0]);
+                    in.imm = target(operands[1], 0);
+                }
+                break;
+            case Syntax::J:
+                expect(1);
+                in.imm = target(operands[0], 0);
+                break;
+            case Syntax::Jalr:
+                if (statement.count == 1) {
+                    in.rd = 1;
+                    in.rs1 = reg(operands[0]);
+                } else if (statement.count == 2) {
+                    in.rd = reg(operands[0]);
+                    std::tie(in.imm, in.rs1) = memoryOperand(operands[1]);
+                } else {
+                    in.rd = reg(operands[0]);
+                    in.rs1 = reg(operands[1]);
+                    in.imm = number(operands[2]);
+                }
+                break;
+            case Syntax::Jr:
+                expect(1);
+                in.rs1 = reg(operands[0]);
+                break;
+            case Syntax::Ret:
+                expect(0);
+                in.rs1 = 1;
+                break;
+            case Syntax::Nop:
+                expect(0);
+                break;
+            case Syntax::Mv:
+                expect(2);
+                in.rd = reg(operands[0]);
+                in.rs1 = reg(operands[1]);
+                break;
+            case Syntax::Li: {
+                expect(2);
+                in.rd = reg(operands[0]);
+                int32_t value = number(operands[1]), upper, lower;
+                if (splitUpper(value, upper, lower)) {
+                    push({Opcode::LUI, in.rd, 0, 0, upper}, address);
+                    in.rs1 = in.rd;
+                    in.imm = lower;
+                    push(in, address + 4);
+                    return;
+                }
+                if (upper != 0) {
+                    in = {Opcode::LUI, in.rd, 0, 0, upper};
+                } else {
+                    in.imm = lower;
+                }
+                break;
+            }
+            case Syntax::La: {
+                expect(2);
+                in.rd = reg(operands[0]);
+                int32_t offset = target(operands[1], 0) - static_cast<int32_t>(address), upper, lower;
+                splitUpper(offset, upper, lower);
+                in.imm = static_cast<int32_t>(address) + upper;
+                push(in, address);
+                push({Opcode::ADDI, in.rd, in.rd, 0, lower}, address + 4);
+                return;
+            }
+            case Syntax::None:
+                expect(0);
+                break;
+        }
+        checkRange(in, address);
+        push(in, address);
+    }
+};
+
+// source already in memory; name is used in error messages and the miss profile
+inline Program assemble(const std::string& name, std::string_view source, std::vector<uint32_t>& binary) {
+    Assembler assembler(name, source);
+    binary = std::move(assembler.binary);
+    Program program;
+    program.code = std::move(assembler.code);
+    program.source = name;
+    program.lines = std::move(assembler.lines);
+    return program;
+}
+
+inline Program parseAssembly(const std::string& asmFile, std::vector<uint32_t>& binary) {
+    MappedFile file(asmFile);
+    return assemble(asmFile, file.text(), binary);
+}
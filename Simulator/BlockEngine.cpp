@@ -0,0 +1,354 @@
+#pragma once
+
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Simulator/Executor.cpp"
+#include "Simulator/Program.cpp"
+
+// superinstructions and block terminators on top of the plain opcodes
+#define BLOCK_FUSED_OPS(X) \
+    /* lui/auipc + addi */ X(LI) \
+    /* add/addi + lw/sw on the result */ X(ADD_LW) X(ADDI_LW) X(ADD_SW) X(ADDI_SW) \
+    /* slt* + beqz/bnez on the result */ X(SLT_BR) X(SLTU_BR) X(SLTI_BR) X(SLTIU_BR) \
+    /* addi + branch */ X(ADDI_BEQ) X(ADDI_BLT) X(ADDI_BLTU) \
+    /* end of code without a control transfer */ X(GOTO)
+
+enum class BlockOp : uint8_t {
+#define BLOCK_OP_ENUM(name) name,
+    RV_OPCODES(BLOCK_OP_ENUM)
+    BLOCK_FUSED_OPS(BLOCK_OP_ENUM)
+#undef BLOCK_OP_ENUM
+};
+
+// One operation of a translated block. Fused operations use rd/rs1/rs2/imm for the first instruction
+// and rs3/imm2 for the memory access or the branch operands; pc is that of the memory access (for the
+// trace) or of the terminator.
+struct MicroOp {
+    BlockOp op;
+    uint8_t rd = 0, rs1 = 0, rs2 = 0, rs3 = 0;
+    int32_t imm = 0, imm2 = 0;
+    uint32_t pc = 0;
+};
+
+// Straight-line code up to and including the first control transfer. target[0] is the fall-through
+// address and target[1] the taken one; next[] caches the translated successors once they are known,
+// so hot loops chain from block to block without looking anything up.
+struct Block {
+    uint32_t pc = 0;
+    uint32_t length = 0;            // guest instructions
+    std::vector<MicroOp> ops;
+    uint32_t target[2] = {0, 0};
+    Block* next[2] = {nullptr, nullptr};
+};
+
+// Translates basic blocks of a program on first entry and keeps them for the rest of the run.
+class BlockCache {
+public:
+    const Program& program;
+    std::deque<Block> blocks;
+    std::vector<Block*> byIndex;    // instruction index -> block starting there
+
+    explicit BlockCache(const Program& program) : program(program), byIndex(program.code.size(), nullptr) {}
+
+    // nullptr when pc is outside the code
+    Block* lookup(uint32_t pc) {
+        uint32_t index = (pc - program.base) / 4;
+        if (index >= byIndex.size()) return nullptr;
+        if (!byIndex[index]) byIndex[index] = translate(index);
+        return byIndex[index];
+    }
+
+    // a jump to 0 ends the program, like in execute()
+    Block* resolve(uint32_t target) {
+        return target == 0 ? nullptr : lookup(target);
+    }
+
+    static bool isBranch(Opcode op) { return op >= Opcode::BEQ && op <= Opcode::BGEU; }
+    static bool isTerminator(Opcode op) {
+        return isBranch(op) || op == Opcode::JAL || op == Opcode::JALR || op == Opcode::ECALL ||
+               op == Opcode::EBREAK || op == Opcode::ILLEGAL;
+    }
+
+    Block* translate(uint32_t index) {
+        const std::vector<Instruction>& code = program.code;
+        Block& block = blocks.emplace_back();
+        block.pc = program.base + index * 4;
+        for (uint32_t i = index; i < code.size(); ++i) {
+            const Instruction& a = code[i];
+            uint32_t pc = program.base + i * 4;
+            MicroOp op{static_cast<BlockOp>(a.op), a.rd, a.rs1, a.rs2, 0, a.imm, 0, pc};
+            ++block.length;
+
+            if (i + 1 < code.size() && fuse(a, code[i + 1], pc + 4, op, block)) {
+                ++block.length;
+                block.ops.push_back(op);
+                if (isTerminator(code[i + 1].op)) return &block;
+                ++i;
+                continue;
+            }
+            block.ops.push_back(op);
+            if (isTerminator(a.op)) {
+                block.target[0] = pc + 4;
+                block.target[1] = static_cast<uint32_t>(a.imm);
+                return &block;
+            }
+        }
+        block.ops.push_back({BlockOp::GOTO});
+        block.target[0] = program.base + static_cast<uint32_t>(code.size()) * 4;
+        return &block;
+    }
+
+    // rewrites op into a superinstruction covering a and b (b at pc) when the pair has one
+    static bool fuse(const Instruction& a, const Instruction& b, uint32_t pc, MicroOp& op, Block& block) {
+        if ((a.op == Opcode::LUI || a.op == Opcode::AUIPC) && b.op == Opcode::ADDI && b.rd == a.rd && b.rs1 == a.rd) {
+            op.op = BlockOp::LI;
+            op.imm = static_cast<int32_t>(static_cast<uint32_t>(a.imm) + static_cast<uint32_t>(b.imm));
+            return true;
+        }
+        if ((a.op == Opcode::ADD || a.op == Opcode::ADDI) && a.rd != 0 && b.rs1 == a.rd &&
+            (b.op == Opcode::LW || b.op == Opcode::SW)) {
+            bool add = a.op == Opcode::ADD;
+            if (b.op == Opcode::LW) op.op = add ? BlockOp::ADD_LW : BlockOp::ADDI_LW;
+            else op.op = add ? BlockOp::ADD_SW : BlockOp::ADDI_SW;
+            op.rs3 = b.op == Opcode::LW ? b.rd : b.rs2;
+            op.imm2 = b.imm;
+            op.pc = pc;
+            return true;
+        }
+        if (a.op == Opcode::SLT || a.op == Opcode::SLTU || a.op == Opcode::SLTI || a.op == Opcode::SLTIU) {
+            bool zeroTest = (b.op == Opcode::BEQ || b.op == Opcode::BNE) && a.rd != 0 &&
+                            ((b.rs1 == a.rd && b.rs2 == 0) || (b.rs1 == 0 && b.rs2 == a.rd));
+            if (!zeroTest) return false;
+            op.op = a.op == Opcode::SLT ? BlockOp::SLT_BR : a.op == Opcode::SLTU ? BlockOp::SLTU_BR :
+                    a.op == Opcode::SLTI ? BlockOp::SLTI_BR : BlockOp::SLTIU_BR;
+            // beqz takes the branch when the comparison is false
+            bool swap = b.op == Opcode::BEQ;
+            block.target[swap] = pc + 4;
+            block.target[!swap] = static_cast<uint32_t>(b.imm);
+            op.pc = pc;
+            return true;
+        }
+        if (a.op == Opcode::ADDI && a.rd != 0 && isBranch(b.op)) {
+            bool swap = b.op == Opcode::BNE || b.op == Opcode::BGE || b.op == Opcode::BGEU;
+            op.op = b.op == Opcode::BEQ || b.op == Opcode::BNE ? BlockOp::ADDI_BEQ :
+                    b.op == Opcode::BLT || b.op == Opcode::BGE ? BlockOp::ADDI_BLT : BlockOp::ADDI_BLTU;
+            op.rs2 = b.rs1;
+            op.rs3 = b.rs2;
+            block.target[swap] = pc + 4;
+            block.target[!swap] = static_cast<uint32_t>(b.imm);
+            op.pc = pc;
+            return true;
+        }
+        return false;
+    }
+};
+
+// Same semantics as execute(), but runs translated blocks: instructions are counted and fetched once
+// per block, handlers fall straight into the next operation and every block exit follows its cached
+// successor. The limit is checked on block entry, so a run may overshoot it by one block; the cache
+// can be kept to resume later without translating again.
+inline void executeBlocks(Simulation& simulation, BlockCache& cache, uint64_t limit = UINT64_MAX) {
+    int32_t* x = simulation.registers.data();
+    uint32_t pc = simulation.pc;
+    uint64_t retired = 0;
+    const bool fetch = simulation.beginFetch();
+    Block* block = cache.lookup(pc);
+    const MicroOp* u;
+
+#define U(reg) static_cast<uint32_t>(x[reg])
+#define WRITE(value) x[u->rd] = static_cast<int32_t>(value)
+#define NEXT() do { ++u; x[0] = 0; goto dispatch; } while (0)
+#define CHAIN(i) do { Block* n = block->next[i]; x[0] = 0; \
+        if (!n) { pc = block->target[i]; if (!(n = block->next[i] = cache.resolve(pc))) goto done; } \
+        block = n; goto enter; } while (0)
+#define BRANCH(cond) do { if (cond) CHAIN(1); CHAIN(0); } while (0)
+#define ACCESS(address, type, T) do { simulation.pc = u->pc; simulation.request(address, type, sizeof(T)); } while (0)
+#define LOAD(T, type) do { uint32_t address = U(u->rs1) + u->imm; ACCESS(address, Type::r, T); \
+        WRITE(static_cast<type>(simulation.load<T>(address))); NEXT(); } while (0)
+#define STORE(T) do { uint32_t address = U(u->rs1) + u->imm; ACCESS(address, Type::w, T); \
+        simulation.store<T>(address, static_cast<T>(x[u->rs2])); NEXT(); } while (0)
+
+#if RV_THREADED_DISPATCH
+    static const void* labels[] = {
+#define BLOCK_OP_LABEL(name) &&op_##name,
+            RV_OPCODES(BLOCK_OP_LABEL)
+            BLOCK_FUSED_OPS(BLOCK_OP_LABEL)
+#undef BLOCK_OP_LABEL
+    };
+#define CASE(name) op_##name:
+#else
+#define CASE(name) case BlockOp::name:
+#endif
+
+    if (!block) goto done;
+enter:
+    if (retired >= limit) {
+        pc = block->pc;
+        goto pause;
+    }
+    retired += block->length;
+    if (fetch) simulation.fetch(block->pc, block->pc + 4 * block->length);
+    u = block->ops.data();
+dispatch:
+#if RV_THREADED_DISPATCH
+    goto *labels[static_cast<int>(u->op)];
+#else
+    switch (u->op) {
+#endif
+    CASE(ADD) WRITE(U(u->rs1) + U(u->rs2)); NEXT();
+    CASE(SUB) WRITE(U(u->rs1) - U(u->rs2)); NEXT();
+    CASE(SLL) WRITE(U(u->rs1) << (x[u->rs2] & 31)); NEXT();
+    CASE(SLT) WRITE(x[u->rs1] < x[u->rs2]); NEXT();
+    CASE(SLTU) WRITE(U(u->rs1) < U(u->rs2)); NEXT();
+    CASE(XOR) WRITE(x[u->rs1] ^ x[u->rs2]); NEXT();
+    CASE(SRL) WRITE(U(u->rs1) >> (x[u->rs2] & 31)); NEXT();
+    CASE(SRA) WRITE(x[u->rs1] >> (x[u->rs2] & 31)); NEXT();
+    CASE(OR) WRITE(x[u->rs1] | x[u->rs2]); NEXT();
+    CASE(AND) WRITE(x[u->rs1] & x[u->rs2]); NEXT();
+    CASE(MUL) WRITE(U(u->rs1) * U(u->rs2)); NEXT();
+    CASE(MULH) WRITE(static_cast<int64_t>(x[u->rs1]) * x[u->rs2] >> 32); NEXT();
+    CASE(MULHSU) WRITE(static_cast<int64_t>(x[u->rs1]) * static_cast<int64_t>(U(u->rs2)) >> 32); NEXT();
+    CASE(MULHU) WRITE(static_cast<uint64_t>(U(u->rs1)) * U(u->rs2) >> 32); NEXT();
+    CASE(DIV) {
+        int32_t a = x[u->rs1], b = x[u->rs2];
+        WRITE(b == 0 ? -1 : (a == INT32_MIN && b == -1) ? a : a / b);
+        NEXT();
+    }
+    CASE(DIVU) WRITE(U(u->rs2) == 0 ? 0xFFFFFFFFu : U(u->rs1) / U(u->rs2)); NEXT();
+    CASE(REM) {
+        int32_t a = x[u->rs1], b = x[u->rs2];
+        WRITE(b == 0 ? a : (a == INT32_MIN && b == -1) ? 0 : a % b);
+        NEXT();
+    }
+    CASE(REMU) WRITE(U(u->rs2) == 0 ? U(u->rs1) : U(u->rs1) % U(u->rs2)); NEXT();
+
+    CASE(ADDI) WRITE(U(u->rs1) + u->imm); NEXT();
+    CASE(SLTI) WRITE(x[u->rs1] < u->imm); NEXT();
+    CASE(SLTIU) WRITE(U(u->rs1) < static_cast<uint32_t>(u->imm)); NEXT();
+    CASE(XORI) WRITE(x[u->rs1] ^ u->imm); NEXT();
+    CASE(ORI) WRITE(x[u->rs1] | u->imm); NEXT();
+    CASE(ANDI) WRITE(x[u->rs1] & u->imm); NEXT();
+    CASE(SLLI) WRITE(U(u->rs1) << (u->imm & 31)); NEXT();
+    CASE(SRLI) WRITE(U(u->rs1) >> (u->imm & 31)); NEXT();
+    CASE(SRAI) WRITE(x[u->rs1] >> (u->imm & 31)); NEXT();
+    CASE(JALR) {
+        // one-entry target cache, usually the return site of the last call
+        uint32_t target = (U(u->rs1) + u->imm) & ~1u;
+        WRITE(u->pc + 4);
+        x[0] = 0;
+        Block* n = block->next[1];
+        if (!n || n->pc != target) {
+            pc = target;
+            if (!(n = cache.resolve(target))) goto done;
+            block->next[1] = n;
+        }
+        block = n;
+        goto enter;
+    }
+    CASE(LB) LOAD(int8_t, int32_t);
+    CASE(LH) LOAD(int16_t, int32_t);
+    CASE(LW) LOAD(int32_t, int32_t);
+    CASE(LBU) LOAD(uint8_t, uint32_t);
+    CASE(LHU) LOAD(uint16_t, uint32_t);
+
+    CASE(SB) STORE(int8_t);
+    CASE(SH) STORE(int16_t);
+    CASE(SW) STORE(int32_t);
+
+    CASE(BEQ) BRANCH(x[u->rs1] == x[u->rs2]);
+    CASE(BNE) BRANCH(x[u->rs1] != x[u->rs2]);
+    CASE(BLT) BRANCH(x[u->rs1] < x[u->rs2]);
+    CASE(BGE) BRANCH(x[u->rs1] >= x[u->rs2]);
+    CASE(BLTU) BRANCH(U(u->rs1) < U(u->rs2));
+    CASE(BGEU) BRANCH(U(u->rs1) >= U(u->rs2));
+
+    CASE(LUI) WRITE(u->imm); NEXT();
+    CASE(AUIPC) WRITE(u->imm); NEXT();
+    CASE(JAL) WRITE(u->pc + 4); CHAIN(1);
+
+    CASE(FENCE) NEXT();
+    CASE(ECALL) {
+        if (x[17] == 93) {              // exit
+            pc = u->pc;
+            goto done;
+        }
+        CHAIN(0);
+    }
+    CASE(EBREAK) pc = u->pc; goto done;
+
+    CASE(ILLEGAL) {
+        simulation.pc = u->pc;
+        simulation.instructions += retired;
+        throw std::runtime_error("Illegal instruction at pc " + std::to_string(u->pc));
+    }
+
+    CASE(LI) WRITE(u->imm); NEXT();
+    CASE(ADD_LW) {
+        WRITE(U(u->rs1) + U(u->rs2));
+        uint32_t address = U(u->rd) + u->imm2;
+        ACCESS(address, Type::r, int32_t);
+        x[u->rs3] = simulation.load<int32_t>(address);
+        NEXT();
+    }
+    CASE(ADDI_LW) {
+        WRITE(U(u->rs1) + u->imm);
+        uint32_t address = U(u->rd) + u->imm2;
+        ACCESS(address, Type::r, int32_t);
+        x[u->rs3] = simulation.load<int32_t>(address);
+        NEXT();
+    }
+    CASE(ADD_SW) {
+        WRITE(U(u->rs1) + U(u->rs2));
+        uint32_t address = U(u->rd) + u->imm2;
+        ACCESS(address, Type::w, int32_t);
+        simulation.store<int32_t>(address, x[u->rs3]);
+        NEXT();
+    }
+    CASE(ADDI_SW) {
+        WRITE(U(u->rs1) + u->imm);
+        uint32_t address = U(u->rd) + u->imm2;
+        ACCESS(address, Type::w, int32_t);
+        simulation.store<int32_t>(address, x[u->rs3]);
+        NEXT();
+    }
+    CASE(SLT_BR) { bool c = x[u->rs1] < x[u->rs2]; WRITE(c); BRANCH(c); }
+    CASE(SLTU_BR) { bool c = U(u->rs1) < U(u->rs2); WRITE(c); BRANCH(c); }
+    CASE(SLTI_BR) { bool c = x[u->rs1] < u->imm; WRITE(c); BRANCH(c); }
+    CASE(SLTIU_BR) { bool c = U(u->rs1) < static_cast<uint32_t>(u->imm); WRITE(c); BRANCH(c); }
+    CASE(ADDI_BEQ) WRITE(U(u->rs1) + u->imm); BRANCH(x[u->rs2] == x[u->rs3]);
+    CASE(ADDI_BLT) WRITE(U(u->rs1) + u->imm); BRANCH(x[u->rs2] < x[u->rs3]);
+    CASE(ADDI_BLTU) WRITE(U(u->rs1) + u->imm); BRANCH(U(u->rs2) < U(u->rs3));
+    CASE(GOTO) CHAIN(0);
+#if !RV_THREADED_DISPATCH
+    default: break;
+    }
+#endif
+
+pause:
+    simulation.pc = pc;
+    simulation.instructions += retired;
+    simulation.flush();
+    return;
+done:
+    simulation.halted = true;
+    simulation.pc = pc;
+    simulation.instructions += retired;
+    simulation.flush();
+
+#undef U
+#undef WRITE
+#undef NEXT
+#undef CHAIN
+#undef BRANCH
+#undef ACCESS
+#undef LOAD
+#undef STORE
+#undef CASE
+}
+
+inline void executeBlocks(Simulation& simulation, const Program& program) {
+    BlockCache cache(program);
+    executeBlocks(simulation, cache);
+}
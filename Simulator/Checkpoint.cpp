@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Entities/StateStream.cpp"
+#include "Simulator/Program.cpp"
+#include "Simulator/Simulation.cpp"
+#include "Trace/MappedFile.cpp"
+
+// Checkpoint file layout:
+//   header  "RVCK" + u32 version + u64 fingerprint of the program's code
+//   state   pc, retired instructions, x0-x31
+//   memory  u32 page count, then (u32 page number, 4 KB of bytes) for every guest page that is not all zero
+//   caches  for each flat model, the I-cache and every hierarchy level: name, policy, geometry, contents
+//           and replacement state; a flat model's prefetcher follows its cache
+// Statistics are not saved: a restored run reports the accesses it makes itself.
+
+constexpr char CHECKPOINT_MAGIC[4] = {'R', 'V', 'C', 'K'};
+constexpr uint32_t CHECKPOINT_VERSION = 3;
+
+// FNV-1a over the load address and the predecoded code, so a checkpoint only resumes the program it came from
+inline uint64_t programFingerprint(const Program& program) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    auto mix = [&hash](const void* data, size_t size) {
+        const auto* p = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) hash = (hash ^ p[i]) * 0x100000001B3ull;
+    };
+    mix(&program.base, sizeof(program.base));
+    mix(program.code.data(), program.code.size() * sizeof(Instruction));
+    return hash;
+}
+
+inline void saveCache(StateWriter& out, const std::string& name, const CacheBase& cache) {
+    out.put(name);
+    out.put(cache.policy);
+    out.put(cache.config.size);
+    out.put(cache.config.lineSize);
+    out.put(cache.config.ways);
+    out.put(cache.config.addrLen);
+    cache.saveState(out);
+}
+
+inline void loadCache(StateReader& in, const std::string& name, CacheBase& cache) {
+    std::string saved = in.getString(), policy = in.getString();
+    uint32_t size = in.get<uint32_t>(), lineSize = in.get<uint32_t>(), ways = in.get<uint32_t>(),
+            addrLen = in.get<uint32_t>();
+    // the policy decides how the replacement state reads, and state sizes do not always tell policies apart
+    if (saved != name || policy != cache.policy || size != cache.config.size || lineSize != cache.config.lineSize ||
+        ways != cache.config.ways || addrLen != cache.config.addrLen)
+        throw std::runtime_error("Checkpoint holds cache '" + saved + "' (" + policy + "), the run has '" + name + "' (" +
+                                 cache.policy + ") here");
+    cache.loadState(in);
+}
+
+inline uint64_t saveCheckpoint(const std::string& path, const Simulation& simulation, const Program& program) {
+    StateWriter out;
+    out.append(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    out.put(CHECKPOINT_VERSION);
+    out.put(programFingerprint(program));
+
+    out.put(simulation.pc);
+    out.put(simulation.instructions);
+    out.put(simulation.registers);
+
+    std::vector<std::pair<uint32_t, const uint8_t*>> used;
+    simulation.memory.forEachPage([&used](uint32_t number, const uint8_t* data) {
+        for (uint32_t i = 0; i < GuestMemory::PAGE_SIZE; ++i) {
+            if (data[i]) {
+                used.emplace_back(number, data);
+                break;
+            }
+        }
+    });
+    out.put(static_cast<uint32_t>(used.size()));
+    for (auto [number, data] : used) {
+        out.put(number);
+        out.append(data, GuestMemory::PAGE_SIZE);
+    }
+
+    out.put(static_cast<uint32_t>(simulation.simulators.size()));
+    for (const CacheSimulator& simulator : simulation.simulators) {
+        saveCache(out, simulator.name, *simulator.cache);
+        if (simulator.prefetcher) simulator.prefetcher->saveState(out);
+    }
+    out.put(static_cast<uint8_t>(simulation.icache != nullptr));
+    if (simulation.icache) saveCache(out, simulation.icache->name, *simulation.icache->cache);
+    out.put(static_cast<uint32_t>(simulation.hierarchy ? simulation.hierarchy->levels.size() : 0));
+    if (simulation.hierarchy) {
+        for (const CacheLevel& level : simulation.hierarchy->levels) saveCache(out, level.name, *level.cache);
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error("Cannot open checkpoint file: " + path);
+    file.write(reinterpret_cast<const char*>(out.bytes.data()), out.bytes.size());
+    if (!file) throw std::runtime_error("Cannot write checkpoint file: " + path);
+    return out.bytes.size();
+}
+
+// restores into a simulation set up with the same program and cache models as the one saved
+inline void restoreCheckpoint(const std::string& path, Simulation& simulation, const Program& program) {
+    MappedFile file(path);
+    StateReader in(file.data, file.size);
+    char magic[4];
+    in.copy(magic, sizeof(magic));
+    if (std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0) throw std::runtime_error("Not a checkpoint: " + path);
+    if (in.get<uint32_t>() != CHECKPOINT_VERSION) throw std::runtime_error("Unsupported checkpoint version: " + path);
+    if (in.get<uint64_t>() != programFingerprint(program))
+        throw std::runtime_error("Checkpoint " + path + " was taken from a different program");
+
+    simulation.pc = in.get<uint32_t>();
+    simulation.instructions = in.get<uint64_t>();
+    simulation.registers = in.get<std::array<int32_t, 32>>();
+    simulation.halted = false;
+
+    simulation.memory.clear();
+    uint32_t pages = in.get<uint32_t>();
+    std::vector<uint8_t> page(GuestMemory::PAGE_SIZE);
+    for (uint32_t i = 0; i < pages; ++i) {
+        uint32_t number = in.get<uint32_t>();
+        if (number >= (1u << (32 - GuestMemory::PAGE_BITS))) throw std::runtime_error("Corrupted checkpoint: " + path);
+        in.copy(page.data(), page.size());
+        simulation.memory.write(number << GuestMemory::PAGE_BITS, page.data(), page.size());
+    }
+
+    if (in.get<uint32_t>() != simulation.simulators.size())
+        throw std::runtime_error("Checkpoint has a different number of cache models");
+    for (CacheSimulator& simulator : simulation.simulators) {
+        // the name includes the prefetcher, so a matching cache also tells whether its state follows
+        loadCache(in, simulator.name, *simulator.cache);
+        if (simulator.prefetcher) simulator.prefetcher->loadState(in);
+    }
+    if (in.get<uint8_t>() != (simulation.icache != nullptr))
+        throw std::runtime_error("Checkpoint and run disagree on the instruction cache");
+    if (simulation.icache) loadCache(in, simulation.icache->name, *simulation.icache->cache);
+    if (in.get<uint32_t>() != (simulation.hierarchy ? simulation.hierarchy->levels.size() : 0))
+        throw std::runtime_error("Checkpoint has a different cache hierarchy");
+    if (simulation.hierarchy) {
+        for (CacheLevel& level : simulation.hierarchy->levels) loadCache(in, level.name, *level.cache);
+    }
+    if (!in.atEnd()) throw std::runtime_error("Corrupted checkpoint: " + path);
+}
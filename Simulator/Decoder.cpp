@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include "Simulator/Instruction.cpp"
+
+// RV32IM machine code -> Instruction; anything else decodes to ILLEGAL
+inline Instruction decodeMachineCode(uint32_t word, uint32_t address) {
+    static constexpr Opcode OP[8] = {Opcode::ADD, Opcode::SLL, Opcode::SLT, Opcode::SLTU,
+                                     Opcode::XOR, Opcode::SRL, Opcode::OR, Opcode::AND};
+    static constexpr Opcode MULDIV[8] = {Opcode::MUL, Opcode::MULH, Opcode::MULHSU, Opcode::MULHU,
+                                         Opcode::DIV, Opcode::DIVU, Opcode::REM, Opcode::REMU};
+    static constexpr Opcode OP_IMM[8] = {Opcode::ADDI, Opcode::SLLI, Opcode::SLTI, Opcode::SLTIU,
+                                         Opcode::XORI, Opcode::SRLI, Opcode::ORI, Opcode::ANDI};
+    static constexpr Opcode LOADS[8] = {Opcode::LB, Opcode::LH, Opcode::LW, Opcode::ILLEGAL,
+                                        Opcode::LBU, Opcode::LHU, Opcode::ILLEGAL, Opcode::ILLEGAL};
+    static constexpr Opcode STORES[8] = {Opcode::SB, Opcode::SH, Opcode::SW, Opcode::ILLEGAL,
+                                         Opcode::ILLEGAL, Opcode::ILLEGAL, Opcode::ILLEGAL, Opcode::ILLEGAL};
+    static constexpr Opcode BRANCHES[8] = {Opcode::BEQ, Opcode::BNE, Opcode::ILLEGAL, Opcode::ILLEGAL,
+                                           Opcode::BLT, Opcode::BGE, Opcode::BLTU, Opcode::BGEU};
+
+    Instruction in;
+    in.rd = (word >> 7) & 31;
+    in.rs1 = (word >> 15) & 31;
+    in.rs2 = (word >> 20) & 31;
+    uint32_t funct3 = (word >> 12) & 7;
+    uint32_t funct7 = word >> 25;
+    int32_t immI = static_cast<int32_t>(word) >> 20;
+
+    // clear the register fields a format does not have, so decoded and assembled records compare equal
+    uint32_t opcode = word & 0x7F;
+    if (opcode == 0x13 || opcode == 0x03 || opcode == 0x67) in.rs2 = 0;
+    if (opcode == 0x23 || opcode == 0x63) in.rd = 0;
+    if (opcode == 0x37 || opcode == 0x17 || opcode == 0x6F) in.rs1 = in.rs2 = 0;
+    if (opcode == 0x0F || opcode == 0x73) in.rd = in.rs1 = in.rs2 = 0;
+
+    switch (opcode) {
+        case 0x33:
+            if (funct7 == 0x00) in.op = OP[funct3];
+            else if (funct7 == 0x01) in.op = MULDIV[funct3];
+            else if (funct7 == 0x20 && funct3 == 0) in.op = Opcode::SUB;
+            else if (funct7 == 0x20 && funct3 == 5) in.op = Opcode::SRA;
+            break;
+        case 0x13:
+            in.op = OP_IMM[funct3];
+            in.imm = immI;
+            if (funct3 == 1 || funct3 == 5) {
+                in.imm = (word >> 20) & 31;
+                if (funct3 == 5 && funct7 == 0x20) in.op = Opcode::SRAI;
+                else if (funct7 != 0) in.op = Opcode::ILLEGAL;
+            }
+            break;
+        case 0x03:
+            in.op = LOADS[funct3];
+            in.imm = immI;
+            break;
+        case 0x67:
+            if (funct3 == 0) in.op = Opcode::JALR;
+            in.imm = immI;
+            break;
+        case 0x23:
+            in.op = STORES[funct3];
+            in.imm = (static_cast<int32_t>(word & 0xFE000000) >> 20) | static_cast<int32_t>((word >> 7) & 0x1F);
+            break;
+        case 0x63:
+            in.op = BRANCHES[funct3];
+            in.imm = static_cast<int32_t>(address) + ((static_cast<int32_t>(word & 0x80000000) >> 19)
+                     | static_cast<int32_t>(((word & 0x80) << 4) | ((word >> 20) & 0x7E0) | ((word >> 7) & 0x1E)));
+            break;
+        case 0x37:
+            in.op = Opcode::LUI;
+            in.imm = static_cast<int32_t>(word & 0xFFFFF000);
+            break;
+        case 0x17:
+            in.op = Opcode::AUIPC;
+            in.imm = static_cast<int32_t>(address + (word & 0xFFFFF000));
+            break;
+        case 0x6F:
+            in.op = Opcode::JAL;
+            in.imm = static_cast<int32_t>(address) + ((static_cast<int32_t>(word & 0x80000000) >> 11)
+                     | static_cast<int32_t>((word & 0xFF000) | ((word >> 9) & 0x800) | ((word >> 20) & 0x7FE)));
+            break;
+        case 0x0F:
+            in.op = Opcode::FENCE;
+            break;
+        case 0x73:
+            if (word == 0x00000073) in.op = Opcode::ECALL;
+            else if (word == 0x00100073) in.op = Opcode::EBREAK;
+            break;
+    }
+    return in;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include "Simulator/Instruction.cpp"
+
+enum class Format : uint8_t {
+    R, I, Shift, S, B, U, J, System
+};
+
+struct Encoding {
+    Format format;
+    uint8_t opcode, funct3, funct7;
+};
+
+// major opcode and function fields of every Opcode, the inverse of decodeMachineCode()
+constexpr Encoding encodingOf(Opcode op) {
+    switch (op) {
+        case Opcode::ADD:    return {Format::R, 0x33, 0, 0x00};
+        case Opcode::SUB:    return {Format::R, 0x33, 0, 0x20};
+        case Opcode::SLL:    return {Format::R, 0x33, 1, 0x00};
+        case Opcode::SLT:    return {Format::R, 0x33, 2, 0x00};
+        case Opcode::SLTU:   return {Format::R, 0x33, 3, 0x00};
+        case Opcode::XOR:    return {Format::R, 0x33, 4, 0x00};
+        case Opcode::SRL:    return {Format::R, 0x33, 5, 0x00};
+        case Opcode::SRA:    return {Format::R, 0x33, 5, 0x20};
+        case Opcode::OR:     return {Format::R, 0x33, 6, 0x00};
+        case Opcode::AND:    return {Format::R, 0x33, 7, 0x00};
+        case Opcode::MUL:    return {Format::R, 0x33, 0, 0x01};
+        case Opcode::MULH:   return {Format::R, 0x33, 1, 0x01};
+        case Opcode::MULHSU: return {Format::R, 0x33, 2, 0x01};
+        case Opcode::MULHU:  return {Format::R, 0x33, 3, 0x01};
+        case Opcode::DIV:    return {Format::R, 0x33, 4, 0x01};
+        case Opcode::DIVU:   return {Format::R, 0x33, 5, 0x01};
+        case Opcode::REM:    return {Format::R, 0x33, 6, 0x01};
+        case Opcode::REMU:   return {Format::R, 0x33, 7, 0x01};
+        case Opcode::ADDI:   return {Format::I, 0x13, 0, 0};
+        case Opcode::SLTI:   return {Format::I, 0x13, 2, 0};
+        case Opcode::SLTIU:  return {Format::I, 0x13, 3, 0};
+        case Opcode::XORI:   return {Format::I, 0x13, 4, 0};
+        case Opcode::ORI:    return {Format::I, 0x13, 6, 0};
+        case Opcode::ANDI:   return {Format::I, 0x13, 7, 0};
+        case Opcode::SLLI:   return {Format::Shift, 0x13, 1, 0x00};
+        case Opcode::SRLI:   return {Format::Shift, 0x13, 5, 0x00};
+        case Opcode::SRAI:   return {Format::Shift, 0x13, 5, 0x20};
+        case Opcode::JALR:   return {Format::I, 0x67, 0, 0};
+        case Opcode::LB:     return {Format::I, 0x03, 0, 0};
+        case Opcode::LH:     return {Format::I, 0x03, 1, 0};
+        case Opcode::LW:     return {Format::I, 0x03, 2, 0};
+        case Opcode::LBU:    return {Format::I, 0x03, 4, 0};
+        case Opcode::LHU:    return {Format::I, 0x03, 5, 0};
+        case Opcode::SB:     return {Format::S, 0x23, 0, 0};
+        case Opcode::SH:     return {Format::S, 0x23, 1, 0};
+        case Opcode::SW:     return {Format::S, 0x23, 2, 0};
+        case Opcode::BEQ:    return {Format::B, 0x63, 0, 0};
+        case Opcode::BNE:    return {Format::B, 0x63, 1, 0};
+        case Opcode::BLT:    return {Format::B, 0x63, 4, 0};
+        case Opcode::BGE:    return {Format::B, 0x63, 5, 0};
+        case Opcode::BLTU:   return {Format::B, 0x63, 6, 0};
+        case Opcode::BGEU:   return {Format::B, 0x63, 7, 0};
+        case Opcode::LUI:    return {Format::U, 0x37, 0, 0};
+        case Opcode::AUIPC:  return {Format::U, 0x17, 0, 0};
+        case Opcode::JAL:    return {Format::J, 0x6F, 0, 0};
+        case Opcode::FENCE:  return {Format::System, 0x0F, 0, 0};
+        case Opcode::ECALL:  return {Format::System, 0x73, 0, 0};
+        case Opcode::EBREAK: return {Format::System, 0x73, 0, 0};
+        default:             return {Format::System, 0x00, 0, 0};
+    }
+}
+
+// Instruction at address -> RV32IM machine code. Immediates are truncated to their field, pc-relative
+// ones (branches, jal, auipc) are taken back from the absolute values the record holds.
+inline uint32_t encodeInstruction(const Instruction& in, uint32_t address) {
+    Encoding e = encodingOf(in.op);
+    uint32_t imm = static_cast<uint32_t>(in.imm);
+    uint32_t word = e.opcode | (e.funct3 << 12);
+    switch (e.format) {
+        case Format::R:
+            return word | (in.rd << 7) | (in.rs1 << 15) | (in.rs2 << 20) | (e.funct7 << 25);
+        case Format::I:
+            return word | (in.rd << 7) | (in.rs1 << 15) | ((imm & 0xFFF) << 20);
+        case Format::Shift:
+            return word | (in.rd << 7) | (in.rs1 << 15) | ((imm & 31) << 20) | (e.funct7 << 25);
+        case Format::S:
+            return word | ((imm & 0x1F) << 7) | (in.rs1 << 15) | (in.rs2 << 20) | ((imm & 0xFE0) << 20);
+        case Format::B:
+            imm -= address;
+            return word | (((imm >> 11) & 1) << 7) | (((imm >> 1) & 0xF) << 8) | (in.rs1 << 15) | (in.rs2 << 20)
+                   | (((imm >> 5) & 0x3F) << 25) | (((imm >> 12) & 1) << 31);
+        case Format::U:
+            if (in.op == Opcode::AUIPC) imm -= address;
+            return word | (in.rd << 7) | (imm & 0xFFFFF000);
+        case Format::J:
+            imm -= address;
+            return word | (in.rd << 7) | (imm & 0xFF000) | (((imm >> 11) & 1) << 20) | (((imm >> 1) & 0x3FF) << 21)
+                   | (((imm >> 20) & 1) << 31);
+        case Format::System:
+            if (in.op == Opcode::FENCE) return 0x0FF0000F;     // fence iorw, iorw
+            if (in.op == Opcode::EBREAK) return 0x00100073;
+            return word;
+    }
+    return 0;
+}
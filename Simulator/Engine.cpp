@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include "Simulator/BlockEngine.cpp"
+#include "Simulator/Executor.cpp"
+
+enum class Engine {
+    Interpreter,    // execute(): one predecoded instruction per dispatch
+    Block           // executeBlocks(): translated basic blocks with superinstructions
+};
+
+inline Engine parseEngine(const std::string& name) {
+    if (name == "interp") return Engine::Interpreter;
+    if (name == "block") return Engine::Block;
+    throw std::runtime_error("Unknown engine: " + name + " (expected interp or block)");
+}
+
+inline void run(Simulation& simulation, const Program& program, Engine engine) {
+    if (engine == Engine::Block) executeBlocks(simulation, program);
+    else execute(simulation, program);
+}
+
+// Runs up to limit more instructions and can be called again to resume; translated blocks are kept
+// between calls.
+class Runner {
+public:
+    Runner(Simulation& simulation, const Program& program, Engine engine)
+            : simulation(simulation), program(program), engine(engine), blocks(program) {}
+
+    // instructions actually run, the block engine stops at the first block boundary past limit
+    uint64_t run(uint64_t limit) {
+        uint64_t before = simulation.instructions;
+        if (engine == Engine::Block) executeBlocks(simulation, blocks, limit);
+        else execute(simulation, program, limit);
+        return simulation.instructions - before;
+    }
+
+private:
+    Simulation& simulation;
+    const Program& program;
+    Engine engine;
+    BlockCache blocks;
+};
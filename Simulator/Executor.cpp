@@ -0,0 +1,158 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Simulator/Program.cpp"
+
+#if defined(__GNUC__)
+#define RV_THREADED_DISPATCH 1
+#else
+#define RV_THREADED_DISPATCH 0
+#endif
+
+// Runs predecoded instructions from simulation.pc until control leaves the program's code, jumps
+// to 0 or an exit ecall (a7 = 93) is made, which sets simulation.halted, or until limit instructions
+// have run. GCC/Clang builds jump straight from handler to handler through a label table (computed
+// goto), other compilers use a switch.
+inline void execute(Simulation& simulation, const Program& program, uint64_t limit = UINT64_MAX) {
+    const Instruction* code = program.code.data();
+    const uint32_t size = program.code.size();
+    const uint32_t base = program.base;
+    int32_t* x = simulation.registers.data();
+    uint32_t pc = simulation.pc;
+    uint64_t retired = 0;
+    const bool fetch = simulation.beginFetch();
+    const Instruction* in;
+
+#define U(reg) static_cast<uint32_t>(x[reg])
+#define WRITE(value) x[in->rd] = static_cast<int32_t>(value)
+#define NEXT() do { pc += 4; x[0] = 0; goto dispatch; } while (0)
+#define JUMP(target) do { pc = (target); x[0] = 0; if (pc == 0) goto done; goto dispatch; } while (0)
+#define BRANCH(cond) do { if (cond) JUMP(in->imm); NEXT(); } while (0)
+#define LOAD(T, type) do { uint32_t address = U(in->rs1) + in->imm; simulation.pc = pc; \
+        simulation.request(address, Type::r, sizeof(T)); WRITE(static_cast<type>(simulation.load<T>(address))); NEXT(); } while (0)
+#define STORE(T) do { uint32_t address = U(in->rs1) + in->imm; simulation.pc = pc; \
+        simulation.request(address, Type::w, sizeof(T)); simulation.store<T>(address, static_cast<T>(x[in->rs2])); NEXT(); } while (0)
+
+#if RV_THREADED_DISPATCH
+    static const void* labels[] = {
+#define RV_OPCODE_LABEL(name) &&op_##name,
+            RV_OPCODES(RV_OPCODE_LABEL)
+#undef RV_OPCODE_LABEL
+    };
+#define CASE(name) op_##name:
+#else
+#define CASE(name) case Opcode::name:
+#endif
+
+dispatch:
+    if ((pc - base) / 4 >= size) goto done;
+    if (retired == limit) goto pause;
+    in = &code[(pc - base) / 4];
+    ++retired;
+    if (fetch) simulation.fetch(pc, pc + 4);
+#if RV_THREADED_DISPATCH
+    goto *labels[static_cast<int>(in->op)];
+#else
+    switch (in->op) {
+#endif
+    CASE(ADD) WRITE(U(in->rs1) + U(in->rs2)); NEXT();
+    CASE(SUB) WRITE(U(in->rs1) - U(in->rs2)); NEXT();
+    CASE(SLL) WRITE(U(in->rs1) << (x[in->rs2] & 31)); NEXT();
+    CASE(SLT) WRITE(x[in->rs1] < x[in->rs2]); NEXT();
+    CASE(SLTU) WRITE(U(in->rs1) < U(in->rs2)); NEXT();
+    CASE(XOR) WRITE(x[in->rs1] ^ x[in->rs2]); NEXT();
+    CASE(SRL) WRITE(U(in->rs1) >> (x[in->rs2] & 31)); NEXT();
+    CASE(SRA) WRITE(x[in->rs1] >> (x[in->rs2] & 31)); NEXT();
+    CASE(OR) WRITE(x[in->rs1] | x[in->rs2]); NEXT();
+    CASE(AND) WRITE(x[in->rs1] & x[in->rs2]); NEXT();
+    CASE(MUL) WRITE(U(in->rs1) * U(in->rs2)); NEXT();
+    CASE(MULH) WRITE(static_cast<int64_t>(x[in->rs1]) * x[in->rs2] >> 32); NEXT();
+    CASE(MULHSU) WRITE(static_cast<int64_t>(x[in->rs1]) * static_cast<int64_t>(U(in->rs2)) >> 32); NEXT();
+    CASE(MULHU) WRITE(static_cast<uint64_t>(U(in->rs1)) * U(in->rs2) >> 32); NEXT();
+    CASE(DIV) {
+        int32_t a = x[in->rs1], b = x[in->rs2];
+        WRITE(b == 0 ? -1 : (a == INT32_MIN && b == -1) ? a : a / b);
+        NEXT();
+    }
+    CASE(DIVU) WRITE(U(in->rs2) == 0 ? 0xFFFFFFFFu : U(in->rs1) / U(in->rs2)); NEXT();
+    CASE(REM) {
+        int32_t a = x[in->rs1], b = x[in->rs2];
+        WRITE(b == 0 ? a : (a == INT32_MIN && b == -1) ? 0 : a % b);
+        NEXT();
+    }
+    CASE(REMU) WRITE(U(in->rs2) == 0 ? U(in->rs1) : U(in->rs1) % U(in->rs2)); NEXT();
+
+    CASE(ADDI) WRITE(U(in->rs1) + in->imm); NEXT();
+    CASE(SLTI) WRITE(x[in->rs1] < in->imm); NEXT();
+    CASE(SLTIU) WRITE(U(in->rs1) < static_cast<uint32_t>(in->imm)); NEXT();
+    CASE(XORI) WRITE(x[in->rs1] ^ in->imm); NEXT();
+    CASE(ORI) WRITE(x[in->rs1] | in->imm); NEXT();
+    CASE(ANDI) WRITE(x[in->rs1] & in->imm); NEXT();
+    CASE(SLLI) WRITE(U(in->rs1) << (in->imm & 31)); NEXT();
+    CASE(SRLI) WRITE(U(in->rs1) >> (in->imm & 31)); NEXT();
+    CASE(SRAI) WRITE(x[in->rs1] >> (in->imm & 31)); NEXT();
+    CASE(JALR) {
+        uint32_t target = (U(in->rs1) + in->imm) & ~1u;
+        WRITE(pc + 4);
+        JUMP(target);
+    }
+    CASE(LB) LOAD(int8_t, int32_t);
+    CASE(LH) LOAD(int16_t, int32_t);
+    CASE(LW) LOAD(int32_t, int32_t);
+    CASE(LBU) LOAD(uint8_t, uint32_t);
+    CASE(LHU) LOAD(uint16_t, uint32_t);
+
+    CASE(SB) STORE(int8_t);
+    CASE(SH) STORE(int16_t);
+    CASE(SW) STORE(int32_t);
+
+    CASE(BEQ) BRANCH(x[in->rs1] == x[in->rs2]);
+    CASE(BNE) BRANCH(x[in->rs1] != x[in->rs2]);
+    CASE(BLT) BRANCH(x[in->rs1] < x[in->rs2]);
+    CASE(BGE) BRANCH(x[in->rs1] >= x[in->rs2]);
+    CASE(BLTU) BRANCH(U(in->rs1) < U(in->rs2));
+    CASE(BGEU) BRANCH(U(in->rs1) >= U(in->rs2));
+
+    CASE(LUI) WRITE(in->imm); NEXT();
+    CASE(AUIPC) WRITE(in->imm); NEXT();
+    CASE(JAL) WRITE(pc + 4); JUMP(in->imm);
+
+    CASE(FENCE) NEXT();
+    CASE(ECALL) {
+        if (x[17] == 93) goto done;     // exit
+        NEXT();
+    }
+    CASE(EBREAK) goto done;
+
+    CASE(ILLEGAL) {
+        simulation.pc = pc;
+        simulation.instructions += retired;
+        throw std::runtime_error("Illegal instruction at pc " + std::to_string(pc));
+    }
+#if !RV_THREADED_DISPATCH
+    default: break;
+    }
+#endif
+
+pause:
+    simulation.pc = pc;
+    simulation.instructions += retired;
+    simulation.flush();
+    return;
+done:
+    simulation.halted = true;
+    simulation.pc = pc;
+    simulation.instructions += retired;
+    simulation.flush();
+
+#undef U
+#undef WRITE
+#undef NEXT
+#undef JUMP
+#undef BRANCH
+#undef LOAD
+#undef STORE
+#undef CASE
+}
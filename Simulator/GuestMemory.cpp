@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Sparse guest memory over the whole 32-bit address space. 4 KB pages are allocated zeroed on first
+// touch, so host memory grows with the working set. A two-level page table (1024 tables of 1024
+// pages) maps them, and a 16-entry direct-mapped software TLB in front of it catches nearly every
+// access. Accesses may be unaligned; ones that cross a page boundary take a byte-wise slow path.
+//
+// A memory can also be a private view of a shared one (share()), as every hart of a multi-hart run
+// is: reads go to the shared pages, the first write to a page copies it, and commit() later applies
+// the bytes the view changed to the shared memory. Until then other views do not see them, and the
+// shared memory itself is not written, so views can run on different threads.
+class GuestMemory {
+public:
+    static constexpr uint32_t PAGE_BITS = 12;
+    static constexpr uint32_t PAGE_SIZE = 1u << PAGE_BITS;
+
+    template<class T>
+    T load(uint32_t address) {
+        T value;
+        uint32_t offset = address & (PAGE_SIZE - 1);
+        if (offset + sizeof(T) <= PAGE_SIZE) std::memcpy(&value, page(address) + offset, sizeof(T));
+        else read(address, &value, sizeof(T));
+        return value;
+    }
+
+    template<class T>
+    void store(uint32_t address, T value) {
+        uint32_t offset = address & (PAGE_SIZE - 1);
+        if (offset + sizeof(T) <= PAGE_SIZE) std::memcpy(writablePage(address) + offset, &value, sizeof(T));
+        else write(address, &value, sizeof(T));
+    }
+
+    // any range, wrapping around at the top of the address space
+    void read(uint32_t address, void* out, size_t size) {
+        auto* bytes = static_cast<uint8_t*>(out);
+        while (size) {
+            uint32_t offset = address & (PAGE_SIZE - 1);
+            size_t chunk = std::min<size_t>(size, PAGE_SIZE - offset);
+            std::memcpy(bytes, page(address) + offset, chunk);
+            bytes += chunk;
+            address += chunk;
+            size -= chunk;
+        }
+    }
+
+    void write(uint32_t address, const void* in, size_t size) {
+        const auto* bytes = static_cast<const uint8_t*>(in);
+        while (size) {
+            uint32_t offset = address & (PAGE_SIZE - 1);
+            size_t chunk = std::min<size_t>(size, PAGE_SIZE - offset);
+            std::memcpy(writablePage(address) + offset, bytes, chunk);
+            bytes += chunk;
+            address += chunk;
+            size -= chunk;
+        }
+    }
+
+    void zero(uint32_t address, size_t size) {
+        while (size) {
+            uint32_t offset = address & (PAGE_SIZE - 1);
+            size_t chunk = std::min<size_t>(size, PAGE_SIZE - offset);
+            std::memset(writablePage(address) + offset, 0, chunk);
+            address += chunk;
+            size -= chunk;
+        }
+    }
+
+    // drops every page
+    void clear() {
+        for (auto& table : directory) table.reset();
+        tlb.fill({});
+        twins.clear();
+        pages = 0;
+    }
+
+    // turns this memory into a private view of shared (dropping its own pages)
+    void share(GuestMemory& shared) {
+        clear();
+        backing = &shared;
+    }
+
+    // Writes the bytes this view changed since the last commit to the shared memory and drops the
+    // copies. A page's changes are found by comparing it with a twin taken when it was copied, so a
+    // store that rewrote a byte's old value is not seen; views committed later win for the same byte.
+    void commit() {
+        for (auto& [number, twin] : twins) {
+            const uint8_t* mine = find(number);
+            uint8_t* shared = backing->walk(number);
+            for (uint32_t i = 0; i < PAGE_SIZE; i += 8) {
+                if (std::memcmp(mine + i, twin->data() + i, 8) == 0) continue;
+                for (uint32_t j = i; j < i + 8; ++j) {
+                    if (mine[j] != (*twin)[j]) shared[j] = mine[j];
+                }
+            }
+        }
+        clear();
+    }
+
+    // f(page number, PAGE_SIZE bytes) for every allocated page, in address order
+    template<class F>
+    void forEachPage(F f) const {
+        for (uint32_t hi = 0; hi < TABLES; ++hi) {
+            if (!directory[hi]) continue;
+            for (uint32_t lo = 0; lo < TABLES; ++lo) {
+                if ((*directory[hi])[lo]) f(hi << 10 | lo, (*directory[hi])[lo]->data());
+            }
+        }
+    }
+
+    [[nodiscard]] size_t pageCount() const { return pages; }
+
+private:
+    static constexpr uint32_t TABLES = 1024;
+    static constexpr uint32_t TLB_ENTRIES = 16;
+    using Page = std::array<uint8_t, PAGE_SIZE>;
+    using PageTable = std::array<std::unique_ptr<Page>, TABLES>;
+
+    struct TlbEntry {
+        uint32_t number = UINT32_MAX;   // page number, UINT32_MAX never matches (page numbers have 20 bits)
+        uint32_t writable = UINT32_MAX; // number again when data may be written, a view's shared pages may not
+        uint8_t* data = nullptr;
+    };
+
+    std::array<TlbEntry, TLB_ENTRIES> tlb{};
+    std::array<std::unique_ptr<PageTable>, TABLES> directory;
+    size_t pages = 0;
+    GuestMemory* backing = nullptr;                                 // memory this is a view of
+    std::vector<std::pair<uint32_t, std::unique_ptr<Page>>> twins;  // view: copied pages as they were copied
+
+    uint8_t* page(uint32_t address) {
+        uint32_t number = address >> PAGE_BITS;
+        TlbEntry& entry = tlb[number & (TLB_ENTRIES - 1)];
+        if (entry.number == number) return entry.data;
+        if (!backing) entry = {number, number, walk(number)};
+        else if (uint8_t* own = find(number)) entry = {number, number, own};
+        else if (uint8_t* shared = backing->find(number)) entry = {number, UINT32_MAX, shared};
+        else entry = {number, UINT32_MAX, zeroPage()};
+        return entry.data;
+    }
+
+    uint8_t* writablePage(uint32_t address) {
+        uint32_t number = address >> PAGE_BITS;
+        TlbEntry& entry = tlb[number & (TLB_ENTRIES - 1)];
+        if (entry.writable == number) return entry.data;
+        entry = {number, number, backing ? copy(number) : walk(number)};
+        return entry.data;
+    }
+
+    // page without allocating it, nullptr when untouched; reads nothing that views change
+    [[nodiscard]] uint8_t* find(uint32_t number) const {
+        const auto& table = directory[number >> 10];
+        if (!table) return nullptr;
+        const auto& slot = (*table)[number & (TABLES - 1)];
+        return slot ? slot->data() : nullptr;
+    }
+
+    static uint8_t* zeroPage() {
+        static Page zeros{};
+        return zeros.data();
+    }
+
+    // view: own copy of a page, made on its first write
+    uint8_t* copy(uint32_t number) {
+        if (uint8_t* own = find(number)) return own;
+        uint8_t* own = walk(number);
+        if (const uint8_t* shared = backing->find(number)) std::memcpy(own, shared, PAGE_SIZE);
+        auto twin = std::make_unique<Page>();
+        std::memcpy(twin->data(), own, PAGE_SIZE);
+        twins.emplace_back(number, std::move(twin));
+        return own;
+    }
+
+    uint8_t* walk(uint32_t number) {
+        auto& table = directory[number >> 10];
+        if (!table) table = std::make_unique<PageTable>();
+        auto& slot = (*table)[number & (TABLES - 1)];
+        if (!slot) {
+            slot = std::make_unique<Page>();
+            slot->fill(0);
+            ++pages;
+        }
+        return slot->data();
+    }
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#define RV_OPCODES(X) \
+    /* R */ X(ADD) X(SUB) X(SLL) X(SLT) X(SLTU) X(XOR) X(SRL) X(SRA) X(OR) X(AND) \
+            X(MUL) X(MULH) X(MULHSU) X(MULHU) X(DIV) X(DIVU) X(REM) X(REMU) \
+    /* I */ X(ADDI) X(SLTI) X(SLTIU) X(XORI) X(ORI) X(ANDI) X(SLLI) X(SRLI) X(SRAI) X(JALR) \
+            X(LB) X(LH) X(LW) X(LBU) X(LHU) \
+    /* S */ X(SB) X(SH) X(SW) \
+    /* B */ X(BEQ) X(BNE) X(BLT) X(BGE) X(BLTU) X(BGEU) \
+    /* U, J */ X(LUI) X(AUIPC) X(JAL) \
+    /* system */ X(FENCE) X(ECALL) X(EBREAK) \
+    X(ILLEGAL)
+
+enum class Opcode : uint8_t {
+#define RV_OPCODE_ENUM(name) name,
+    RV_OPCODES(RV_OPCODE_ENUM)
+#undef RV_OPCODE_ENUM
+    COUNT
+};
+
+// One predecoded instruction. Operands are resolved at decode time: branches and jal carry their
+// absolute target, lui its shifted value and auipc its result, so the dispatch loop never
+// recomputes them.
+struct Instruction {
+    Opcode op = Opcode::ILLEGAL;
+    uint8_t rd = 0, rs1 = 0, rs2 = 0;
+    int32_t imm = 0;
+};
+
+static_assert(std::is_trivially_copyable_v<Instruction> && sizeof(Instruction) == 8);
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "Simulator/Decoder.cpp"
+#include "Simulator/Program.cpp"
+
+constexpr uint32_t ELF_STACK_TOP = 0x7FFFFFF0;   // initial sp of an ELF program, 16-byte aligned, grows down
+
+inline std::vector<uint8_t> readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error("Cannot open file: " + path);
+    return {std::istreambuf_iterator<char>(file), {}};
+}
+
+inline std::vector<Instruction> decodeWords(const uint8_t* bytes, size_t size, uint32_t base) {
+    std::vector<Instruction> code(size / 4);
+    for (size_t i = 0; i < code.size(); ++i) {
+        uint32_t word;
+        std::memcpy(&word, bytes + 4 * i, sizeof(word));
+        code[i] = decodeMachineCode(word, base + 4 * i);
+    }
+    return code;
+}
+
+// raw little-endian words as written by --bin, executed from address 0
+inline Program loadBinary(const std::string& path) {
+    std::vector<uint8_t> bytes = readFile(path);
+    Program program;
+    program.code = decodeWords(bytes.data(), bytes.size(), 0);
+    return program;
+}
+
+// static little-endian RV32 ELF executable: PT_LOAD segments go to memory, executable ones are decoded
+inline Program loadElf(const std::string& path) {
+    constexpr uint16_t EM_RISCV = 243;
+    constexpr uint32_t PT_LOAD = 1, PF_X = 1;
+    struct Header {
+        uint8_t ident[16];
+        uint16_t type, machine;
+        uint32_t version, entry, phoff, shoff, flags;
+        uint16_t ehsize, phentsize, phnum, shentsize, shnum, shstrndx;
+    };
+    struct ProgramHeader {
+        uint32_t type, offset, vaddr, paddr, filesz, memsz, flags, align;
+    };
+
+    std::vector<uint8_t> bytes = readFile(path);
+    Header header{};
+    if (bytes.size() < sizeof(header)) throw std::runtime_error("Truncated ELF file: " + path);
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.ident[4] != 1 || header.ident[5] != 1 || header.machine != EM_RISCV)
+        throw std::runtime_error("Not a little-endian RV32 ELF executable: " + path);
+
+    Program program;
+    program.entry = header.entry;
+    uint32_t codeBegin = UINT32_MAX, codeEnd = 0;
+    for (uint32_t i = 0; i < header.phnum; ++i) {
+        ProgramHeader ph{};
+        size_t at = header.phoff + static_cast<size_t>(i) * header.phentsize;
+        if (at + sizeof(ph) > bytes.size()) throw std::runtime_error("Truncated ELF file: " + path);
+        std::memcpy(&ph, bytes.data() + at, sizeof(ph));
+        if (ph.type != PT_LOAD) continue;
+        if (static_cast<size_t>(ph.offset) + ph.filesz > bytes.size()) throw std::runtime_error("Truncated ELF file: " + path);
+        program.segments.push_back({ph.vaddr, {bytes.begin() + ph.offset, bytes.begin() + ph.offset + ph.filesz}, ph.memsz});
+        if (ph.flags & PF_X) {
+            codeBegin = std::min(codeBegin, ph.vaddr);
+            codeEnd = std::max(codeEnd, ph.vaddr + ph.filesz);
+        }
+    }
+    if (codeBegin >= codeEnd) throw std::runtime_error("No executable segment in " + path);
+
+    // decode the executable range as laid out in memory, gaps between segments read as zero words
+    std::vector<uint8_t> text(codeEnd - codeBegin, 0);
+    for (const Segment& segment : program.segments) {
+        for (size_t j = 0; j < segment.bytes.size(); ++j) {
+            uint32_t address = segment.address + j;
+            if (address >= codeBegin && address < codeEnd) text[address - codeBegin] = segment.bytes[j];
+        }
+    }
+    program.base = codeBegin;
+    program.code = decodeWords(text.data(), text.size(), codeBegin);
+    program.stack = ELF_STACK_TOP;
+    return program;
+}
+
+inline Program loadExecutable(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[4] = {};
+    file.read(magic, sizeof(magic));
+    if (std::memcmp(magic, "\x7F" "ELF", 4) == 0) return loadElf(path);
+    return loadBinary(path);
+}
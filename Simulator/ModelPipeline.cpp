@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Cache/CacheSimulator.cpp"
+#include "Entities/AccessBatch.cpp"
+#include "Entities/SpscRing.cpp"
+
+// Runs the flat cache models off the execution thread: every model gets a single-producer/single-
+// consumer ring of access batches and a thread of its own that drains it, so the engine only copies
+// each full batch into the rings and moves on. Run time then follows the slowest model rather than
+// the sum of all of them. The models still see exactly the accesses, in the same order, as when
+// Simulation calls them directly.
+class ModelPipeline {
+public:
+    static constexpr size_t RING_BATCHES = 64;
+    static constexpr uint32_t SPIN = 64;            // empty polls before a consumer yields its core
+    static constexpr std::chrono::microseconds YIELD_FOR{1000};    // how long it then yields before blocking
+    static constexpr uint32_t WAKE_BATCHES = RING_BATCHES / 2; // pushes between wake-ups of a blocked consumer
+
+    explicit ModelPipeline(std::vector<CacheSimulator>& simulators) {
+        for (CacheSimulator& simulator : simulators) {
+            auto& lane = lanes.emplace_back(std::make_unique<Lane>());
+            lane->worker = std::thread([this, &ring = lane->ring, &simulator] { consume(ring, simulator); });
+        }
+    }
+    ModelPipeline(const ModelPipeline&) = delete;
+    ModelPipeline& operator=(const ModelPipeline&) = delete;
+    // an empty batch, which push() never sends, tells a consumer to stop
+    ~ModelPipeline() {
+        for (auto& lane : lanes) {
+            AccessBatch* slot = reserve(*lane);
+            slot->count = 0;
+            lane->ring.publish();
+            lane->ring.wake();
+        }
+        for (auto& lane : lanes) lane->worker.join();
+    }
+
+    // copies the batch into every ring, waiting for room where a model has fallen behind
+    void push(const AccessBatch& batch) {
+        for (auto& lane : lanes) {
+            AccessBatch* slot = reserve(*lane);
+            slot->count = batch.count;
+            std::copy_n(batch.addresses.begin(), batch.count, slot->addresses.begin());
+            std::copy_n(batch.types.begin(), batch.count, slot->types.begin());
+            std::copy_n(batch.sizes.begin(), batch.count, slot->sizes.begin());
+            std::copy_n(batch.pcs.begin(), batch.count, slot->pcs.begin());
+            lane->ring.publish();
+        }
+        // a consumer that went to sleep catches up several batches at a time; drain() wakes it for the rest
+        if (++pushed % WAKE_BATCHES == 0) {
+            for (auto& lane : lanes) lane->ring.wake();
+        }
+    }
+
+    // returns once every model has processed everything pushed; their counters are then safe to read
+    void drain() {
+        for (auto& lane : lanes) lane->ring.waitUntilEmpty();
+    }
+
+private:
+    using Ring = SpscRing<AccessBatch, RING_BATCHES>;
+    struct Lane {
+        Ring ring;
+        std::thread worker;
+    };
+
+    std::vector<std::unique_ptr<Lane>> lanes;
+    uint64_t pushed = 0;
+
+    // a slot in the lane's ring; a full ring wakes the consumer and waits for it
+    static AccessBatch* reserve(Lane& lane) {
+        AccessBatch* slot;
+        while (!(slot = lane.ring.reserve())) {
+            lane.ring.wake();
+            lane.ring.waitForRoom();
+        }
+        return slot;
+    }
+
+    // spins briefly on an empty ring, as pushes are at most a batch apart while the engine runs, then
+    // yields the core for a while, which on a host with fewer cores than models lets the engine make
+    // the next batch; once nothing has come for that long it sleeps until the engine wakes it
+    // (every WAKE_BATCHES pushes, on drain() and at the stop), so idle models leave the cores alone
+    void consume(Ring& ring, CacheSimulator& simulator) {
+        std::chrono::steady_clock::time_point idleSince;
+        for (uint32_t idle = 0;;) {
+            if (AccessBatch* batch = ring.front()) {
+                if (!batch->count) return;
+                simulator.request(*batch);
+                ring.pop();
+                idle = 0;
+            } else if (++idle <= SPIN) {
+                continue;
+            } else if (idle == SPIN + 1) {
+                idleSince = std::chrono::steady_clock::now();
+            } else if (std::chrono::steady_clock::now() - idleSince < YIELD_FOR) {
+                std::this_thread::yield();
+            } else {
+                ring.waitForData();
+                idle = 0;
+            }
+        }
+    }
+};
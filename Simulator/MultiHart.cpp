@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <barrier>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Cache/Coherence.cpp"
+#include "Simulator/Engine.cpp"
+
+// Several harts running one program over shared guest memory, each on its own host thread, in
+// quanta of a fixed number of instructions. During a quantum a hart sees its own stores at once and
+// those of the others from the next quantum on: its memory is a private view (GuestMemory::share)
+// that the barrier between quanta commits, hart by hart in order. The caches do not run in the
+// harts' threads: every hart logs its accesses, and while the harts run the next quantum a further
+// thread replays the logs of the last one through the coherent L1s, one access per hart in turn.
+// The outcome depends on the quantum but never on host timing.
+//
+// Every hart starts at the entry point with a0 = its hart id and a1 = the hart count; when the
+// program sets up a stack, hart i gets sp lowered by i * HART_STACK.
+class MultiHart {
+public:
+    static constexpr uint32_t HART_STACK = 64 * 1024;
+
+    GuestMemory memory;
+    std::vector<std::unique_ptr<Simulation>> harts;
+    CoherentCaches caches;
+    uint64_t quantum = 0;
+    uint64_t quanta = 0;
+
+    MultiHart(const Program& program, uint32_t count, const CacheModelSpec& l1, const CacheModelSpec& l2)
+            : caches(count, l1, l2), program(program), logs(count) {
+        program.loadImage(memory);
+        for (uint32_t h = 0; h < count; ++h) {
+            auto& hart = harts.emplace_back(std::make_unique<Simulation>(std::vector<CacheSimulator>{}));
+            hart->memory.share(memory);
+            hart->pc = program.entry;
+            hart->setReg(10, static_cast<int32_t>(h));
+            hart->setReg(11, static_cast<int32_t>(count));
+            if (program.stack) hart->setReg(2, static_cast<int32_t>(program.stack - h * HART_STACK));
+        }
+    }
+
+    void run(Engine engine, uint64_t instructionsPerQuantum) {
+        quantum = instructionsPerQuantum;
+        uint32_t count = harts.size();
+        int parity = 0;         // logs[h][parity] collect the running quantum, the others are being replayed
+        bool finished = false;
+        std::vector<std::exception_ptr> errors(count);
+        for (uint32_t h = 0; h < count; ++h) harts[h]->accessLog = &logs[h][parity];
+
+        auto barrier = [&]() noexcept {
+            for (auto& hart : harts) hart->memory.commit();
+            parity ^= 1;
+            for (uint32_t h = 0; h < count; ++h) {
+                logs[h][parity].clear();
+                harts[h]->accessLog = &logs[h][parity];
+            }
+            ++quanta;
+            finished = true;
+            for (uint32_t h = 0; h < count; ++h) finished &= harts[h]->halted || errors[h] != nullptr;
+        };
+        std::barrier sync(count + 1, barrier);
+
+        std::vector<std::thread> threads;
+        for (uint32_t h = 0; h < count; ++h) {
+            threads.emplace_back([&, h] {
+                Runner runner(*harts[h], program, engine);
+                while (true) {
+                    if (!harts[h]->halted && !errors[h]) {
+                        try {
+                            runner.run(quantum);
+                        } catch (...) {
+                            errors[h] = std::current_exception();
+                        }
+                    }
+                    sync.arrive_and_wait();
+                    if (finished) return;
+                }
+            });
+        }
+        threads.emplace_back([&] {
+            while (true) {
+                replay(parity ^ 1);
+                sync.arrive_and_wait();
+                if (finished) return;
+            }
+        });
+        for (auto& thread : threads) thread.join();
+        replay(parity ^ 1);
+        for (const auto& error : errors) {
+            if (error) std::rethrow_exception(error);
+        }
+    }
+
+    void print() const {
+        std::vector<uint64_t> instructions;
+        for (const auto& hart : harts) instructions.push_back(hart->instructions);
+        std::printf("harts %zu\tquantum %llu\tquanta %llu\n", harts.size(), (unsigned long long)quantum,
+                    (unsigned long long)quanta);
+        caches.print(instructions);
+    }
+
+private:
+    const Program& program;
+    std::vector<std::array<std::vector<TraceRecord>, 2>> logs;
+
+    void replay(int parity) {
+        size_t longest = 0;
+        for (const auto& log : logs) longest = std::max(longest, log[parity].size());
+        for (size_t i = 0; i < longest; ++i) {
+            for (uint32_t h = 0; h < logs.size(); ++h) {
+                const std::vector<TraceRecord>& log = logs[h][parity];
+                if (i < log.size()) caches.access(h, log[i].address, log[i].type, log[i].size);
+            }
+        }
+    }
+};
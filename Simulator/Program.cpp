@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Simulator/Instruction.cpp"
+#include "Simulator/Simulation.cpp"
+
+struct Segment {
+    uint32_t address;
+    std::vector<uint8_t> bytes;
+    uint32_t memSize;               // bytes past the file image are zero
+};
+
+// predecoded code plus the initial memory image; load() prepares a fresh Simulation to run it
+struct Program {
+    uint32_t base = 0;              // address of code[0]
+    uint32_t entry = 0;
+    uint32_t stack = 0;             // initial sp, 0 keeps the register untouched
+    std::vector<Instruction> code;
+    std::vector<Segment> segments;
+    std::string source;             // assembly file the code came from, empty for machine code
+    std::vector<uint32_t> lines;    // source line of each code entry, empty for machine code
+
+    void load(Simulation& simulation) const {
+        loadImage(simulation.memory);
+        simulation.pc = entry;
+        if (stack) simulation.setReg(2, static_cast<int32_t>(stack));
+    }
+
+    // the segments alone, for memory shared by several harts
+    void loadImage(GuestMemory& memory) const {
+        for (const Segment& segment : segments) {
+            if (static_cast<uint64_t>(segment.address) + segment.memSize > (uint64_t(1) << 32))
+                throw std::runtime_error("Segment at " + std::to_string(segment.address) + " runs past the address space");
+            memory.write(segment.address, segment.bytes.data(), segment.bytes.size());
+            memory.zero(segment.address + segment.bytes.size(), segment.memSize - segment.bytes.size());
+        }
+    }
+};
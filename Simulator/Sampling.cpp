@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Simulator/Engine.cpp"
+
+struct SamplingConfig {
+    uint64_t period = 1000000;      // instructions from one measured window to the next
+    uint64_t warmup = 20000;        // detailed but unmeasured instructions before each window
+    uint64_t window = 10000;        // measured instructions
+
+    // "period=1000000,warmup=20000,window=10000"; omitted keys keep their defaults
+    static SamplingConfig parse(const std::string& spec) {
+        SamplingConfig sampling;
+        std::stringstream ss(spec);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            auto eq = item.find('=');
+            if (eq == std::string::npos) throw std::runtime_error("Expected key=value in sampling spec: " + item);
+            std::string key = CacheConfig::trim(item.substr(0, eq));
+            uint64_t value = std::stoull(CacheConfig::trim(item.substr(eq + 1)), nullptr, 0);
+            if (key == "period") sampling.period = value;
+            else if (key == "warmup") sampling.warmup = value;
+            else if (key == "window") sampling.window = value;
+            else throw std::runtime_error("Unknown sampling parameter: " + key);
+        }
+        if (sampling.window == 0) throw std::runtime_error("Sampling window must not be empty");
+        if (sampling.warmup + sampling.window > sampling.period)
+            throw std::runtime_error("Sampling period must cover the warm-up and the window");
+        return sampling;
+    }
+};
+
+// per-window hits and accesses of one model
+struct SampleSeries {
+    std::vector<uint64_t> hits, accesses;
+
+    // ratio estimate of the hit rate over all windows, in percent
+    [[nodiscard]] double estimate() const {
+        uint64_t h = 0, a = 0;
+        for (size_t i = 0; i < hits.size(); ++i) {
+            h += hits[i];
+            a += accesses[i];
+        }
+        return a ? 100.0 * h / a : 0.0;
+    }
+
+    // half-width of the 95% confidence interval of estimate(), NaN with fewer than two windows
+    [[nodiscard]] double halfWidth() const {
+        size_t n = hits.size();
+        if (n < 2) return NAN;
+        double r = estimate() / 100, mean = 0, sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            mean += accesses[i];
+            double residual = hits[i] - r * accesses[i];
+            sum += residual * residual;
+        }
+        mean /= n;
+        if (mean == 0) return NAN;
+        return 100 * 1.96 * std::sqrt(sum / (n - 1) / n) / mean;
+    }
+};
+
+struct SamplingReport {
+    std::vector<SampleSeries> series;   // one per simulation.simulators entry
+    uint64_t windows = 0;
+    uint64_t detailed = 0;              // instructions run through the cache models, warm-up included
+    uint64_t instructions = 0;
+
+    void print(const Simulation& simulation) const {
+        for (size_t i = 0; i < series.size(); ++i) {
+            double half = series[i].halfWidth();
+            if (std::isnan(half)) {
+                std::printf("%s\thit rate: %3.4f%% (too few windows for an interval)\n",
+                            simulation.simulators[i].name.c_str(), series[i].estimate());
+            } else {
+                std::printf("%s\thit rate: %3.4f%% +- %.4f%% (95%% CI)\n", simulation.simulators[i].name.c_str(),
+                            series[i].estimate(), half);
+            }
+        }
+        std::printf("sampling\twindows %llu\tdetailed %llu of %llu instructions (%.2f%%)\n",
+                    (unsigned long long)windows, (unsigned long long)detailed, (unsigned long long)instructions,
+                    instructions ? 100.0 * detailed / instructions : 0.0);
+    }
+};
+
+// SMARTS-style systematic sampling: each period fast-forwards functionally (no cache model sees the
+// accesses), then runs warmup instructions in detail to rewarm the caches, then measures the next
+// window. The hit rate is estimated from the windows alone.
+inline SamplingReport runSampled(Simulation& simulation, const Program& program, Engine engine,
+                                 const SamplingConfig& sampling) {
+    if (simulation.hierarchy || simulation.icache || simulation.stackDistance || simulation.traceWriter || simulation.profile)
+        throw std::runtime_error("Sampling supports flat cache models only");
+    SamplingReport report;
+    report.series.resize(simulation.simulators.size());
+    Runner runner(simulation, program, engine);
+    uint64_t fastForward = sampling.period - sampling.warmup - sampling.window;
+
+    while (!simulation.halted) {
+        simulation.detailed = false;
+        runner.run(fastForward);
+        if (simulation.halted) break;
+
+        simulation.detailed = true;
+        report.detailed += runner.run(sampling.warmup);
+        if (simulation.halted) break;
+
+        std::vector<uint64_t> hits, accesses;
+        for (const CacheSimulator& simulator : simulation.simulators) {
+            hits.push_back(simulator.Hits);
+            accesses.push_back(simulator.overallRequests);
+        }
+        report.detailed += runner.run(sampling.window);
+        for (size_t i = 0; i < simulation.simulators.size(); ++i) {
+            report.series[i].hits.push_back(simulation.simulators[i].Hits - hits[i]);
+            report.series[i].accesses.push_back(simulation.simulators[i].overallRequests - accesses[i]);
+        }
+        ++report.windows;
+    }
+    simulation.detailed = true;
+    report.instructions = simulation.instructions;
+    return report;
+}
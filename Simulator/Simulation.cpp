@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Cache/CacheHierarchy.cpp"
+#include "Cache/CacheSimulator.cpp"
+#include "Analysis/BeladyOPT.cpp"
+#include "Analysis/PcProfile.cpp"
+#include "Analysis/StackDistance.cpp"
+#include "Simulator/GuestMemory.cpp"
+#include "Simulator/ModelPipeline.cpp"
+#include "Trace/TraceWriter.cpp"
+
+// architectural state and cache models of one run; runs share nothing, so several can execute concurrently
+class Simulation {
+    uint32_t fetchShift = 0;
+    uint32_t fetchLine = UINT32_MAX;    // line looked up by the last fetch()
+    AccessBatch pending;                // accesses the flat models have not seen yet
+
+    void access(uint32_t address, Type type, uint8_t size) {
+        if (!simulators.empty()) {
+            // the profile reads the first model's counters after every access, so it cannot wait for a batch
+            if (profile) {
+                for (auto& simulator : simulators) simulator.request(address, type, size, pc);
+            } else {
+                pending.push(address, type, size, pc);
+                if (pending.full()) submit();
+            }
+        }
+        if (hierarchy) hierarchy->request(address, type, size);
+        if (stackDistance) stackDistance->request(address);
+        if (traceWriter) traceWriter->record(address, type, size, pc);
+        if (accessLog) accessLog->push_back({address, pc, type, size});
+    }
+    void submit() {
+        if (!pending.count) return;
+        if (pipeline) pipeline->push(pending);
+        else for (auto& simulator : simulators) simulator.request(pending);
+        pending.count = 0;
+    }
+    // misses and writebacks of the model named by profiledModel()
+    [[nodiscard]] std::pair<uint64_t, uint64_t> profiledCounters() const {
+        if (!simulators.empty()) return {simulators[0].misses(), simulators[0].writebacks};
+        const CacheLevel& level = hierarchy->levels[hierarchy->dataLevel];
+        return {level.misses, level.writebacks};
+    }
+
+public:
+    std::vector<CacheSimulator> simulators;
+    std::unique_ptr<CacheHierarchy> hierarchy;
+    std::unique_ptr<CacheSimulator> icache;    // flat instruction cache model, fed by fetch()
+    std::unique_ptr<StackDistance> stackDistance;
+    std::unique_ptr<TraceWriter> traceWriter;
+    std::unique_ptr<ModelPipeline> pipeline;   // flat models on threads of their own (declared after simulators, stopped first)
+    std::vector<TraceRecord>* accessLog = nullptr;  // multi-hart runs: this hart's accesses of the current quantum
+    std::vector<BeladyOPT> opt;                // offline optimum for the flat models' geometries, run after the fact
+    std::unique_ptr<PcProfile> profile;        // per-PC misses of the first flat model, or of the hierarchy's data level
+    LatencyModel latency;           // only used to report memory time
+    std::array<int32_t, 32> registers{};
+    GuestMemory memory;
+    uint32_t pc = 0;
+    uint64_t instructions = 0;
+    bool halted = false;            // the program has exited
+    bool detailed = true;           // false while fast-forwarding: accesses skip every model
+    uint64_t fetches = 0;           // instructions fetched through the I-side
+    uint64_t fetchLookups = 0;      // I-side lookups after coalescing fetches within a line
+    explicit Simulation(std::vector<CacheSimulator> simulators) : simulators(std::move(simulators)) {};
+    void request(uint32_t address, Type type, uint8_t size) {
+        if (!detailed) return;
+        if (!profile) return access(address, type, size);
+        auto [misses, writebacks] = profiledCounters();
+        access(address, type, size);
+        auto [missesAfter, writebacksAfter] = profiledCounters();
+        profile->record(pc, missesAfter - misses, writebacksAfter - writebacks);
+    }
+    // Hands the queued accesses to the flat models and, when they run in a pipeline, waits for them.
+    // The engines call it whenever they stop, so the models are current whenever anything outside a
+    // run looks at them.
+    void flush() {
+        submit();
+        if (pipeline) pipeline->drain();
+    }
+    // Prepares fetch() for a run: the coalescing granule is the shortest I-side line. False when
+    // no instruction cache is attached or while fast-forwarding, the engines then skip fetch() altogether.
+    bool beginFetch() {
+        if (!detailed) return false;
+        uint32_t line = UINT32_MAX;
+        if (icache) line = icache->cache->config.lineSize;
+        if (hierarchy && hierarchy->instructionLevel >= 0)
+            line = std::min(line, hierarchy->levels[hierarchy->instructionLevel].cache->config.lineSize);
+        if (line == UINT32_MAX) return false;
+        fetchShift = std::countr_zero(line);
+        fetchLine = UINT32_MAX;
+        return true;
+    }
+    // fetch of the instructions in [begin, end): one lookup per line, none for the line fetched last
+    void fetch(uint32_t begin, uint32_t end) {
+        fetches += (end - begin) / 4;
+        for (uint32_t line = begin >> fetchShift, last = (end - 4) >> fetchShift; line <= last; ++line) {
+            if (line == fetchLine) continue;
+            fetchLine = line;
+            ++fetchLookups;
+            uint32_t address = line << fetchShift;
+            if (icache) icache->request(address, Type::r);
+            if (hierarchy && hierarchy->instructionLevel >= 0)
+                hierarchy->access(hierarchy->instructionLevel, address, Type::r);
+        }
+    }
+    template<class T>
+    T load(uint32_t address) {
+        return memory.load<T>(address);
+    }
+    template<class T>
+    void store(uint32_t address, T value) {
+        memory.store<T>(address, value);
+    }
+    int32_t getReg(int x) {
+        return registers[x];
+    }
+    void setReg(int32_t x, int32_t data) {
+        if (x < 0 || x >= 32) {
+            std::cerr << "Register index out of bounds: " << x << std::endl;
+            return;
+        }
+        if (x == 0) return;
+        registers[x] = data;
+    }
+    double getHitRate(int simulator) {
+        return simulators[simulator].hitRate();
+    }
+    // name of the model the profile attributes misses of
+    [[nodiscard]] std::string profiledModel() const {
+        if (!simulators.empty()) return simulators[0].name;
+        if (hierarchy) return hierarchy->levels[hierarchy->dataLevel].name;
+        throw std::runtime_error("The miss profile needs a data cache");
+    }
+    void printResult() {
+        if (fetches) {
+            std::printf("I-side\tfetches %llu\tlookups %llu\n", (unsigned long long)fetches,
+                        (unsigned long long)fetchLookups);
+            if (icache) icache->print(latency);
+            if (!simulators.empty()) std::printf("D-side\n");
+        }
+        for (const CacheSimulator& simulator : simulators) simulator.print(latency);
+        for (const BeladyOPT& model : opt) model.print(latency);
+        if (hierarchy) hierarchy->print(latency);
+        if (stackDistance) stackDistance->print(1u << stackDistance->offsetLen);
+    }
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <chrono>
+#include <exception>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Cache/CacheFactory.cpp"
+#include "Simulator/Engine.cpp"
+#include "Simulator/ThreadPool.cpp"
+
+struct SweepResult {
+    CacheModelSpec model;
+    uint64_t instructions = 0;
+    uint64_t accesses = 0;
+    uint64_t hits = 0;
+    uint64_t writebacks = 0;
+    double seconds = 0;
+};
+
+// "size=1024,2048;ways=2,4;line=64;policy=lru,plru" -> every combination; geometries that do not
+// derive (e.g. a non power-of-two set count) are skipped and counted in skipped. Unknown keys, policy
+// names, malformed numbers and axes without values are errors.
+inline std::vector<CacheModelSpec> parseSweepGrid(const std::string& grid, const CacheConfig& base, int& skipped) {
+    std::vector<std::pair<std::string, std::vector<std::string>>> axes;
+    std::stringstream ss(grid);
+    std::string axis;
+    while (std::getline(ss, axis, ';')) {
+        auto eq = axis.find('=');
+        if (eq == std::string::npos) throw std::runtime_error("Expected key=v1,v2,... in sweep grid: " + axis);
+        std::vector<std::string> values;
+        std::stringstream vs(axis.substr(eq + 1));
+        std::string value;
+        while (std::getline(vs, value, ',')) values.push_back(CacheConfig::trim(value));
+        std::string key = CacheConfig::trim(axis.substr(0, eq));
+        if (values.empty()) throw std::runtime_error("No values for '" + key + "' in sweep grid");
+        // each value on its own, so a typo fails here instead of being skipped with the whole combination
+        for (const std::string& v : values) {
+            if (key == "policy") {
+                parsePolicy(v);
+                continue;
+            }
+            CacheConfig probe = base;
+            try {
+                probe.set(key, v);
+            } catch (const std::logic_error&) {     // std::stoul on a value that is not a number
+                throw std::runtime_error("Invalid value for '" + key + "' in sweep grid: '" + v + "'");
+            }
+        }
+        axes.emplace_back(key, values);
+    }
+
+    std::vector<CacheModelSpec> models;
+    std::vector<size_t> pos(axes.size(), 0);
+    skipped = 0;
+    while (true) {
+        CacheModelSpec model;
+        model.config = base;
+        for (size_t i = 0; i < axes.size(); ++i) {
+            const std::string& value = axes[i].second[pos[i]];
+            if (axes[i].first == "policy") model.policy = parsePolicy(value);
+            else model.config.set(axes[i].first, value);
+        }
+        try {
+            model.config.derive();
+            models.push_back(model);
+        } catch (const std::runtime_error&) {
+            ++skipped;
+        }
+        size_t i = axes.size();
+        while (i > 0 && ++pos[i - 1] == axes[i - 1].second.size()) pos[--i] = 0;
+        if (i == 0) break;
+    }
+    return models;
+}
+
+// runs the program once per model, every run with its own Simulation; the first run that fails
+// rethrows its error once all runs are done
+inline std::vector<SweepResult> runSweep(const Program& program, const std::vector<CacheModelSpec>& models,
+                                         unsigned threads, Engine engine = Engine::Block) {
+    std::vector<SweepResult> results(models.size());
+    std::vector<std::exception_ptr> errors(models.size());
+    ThreadPool pool(threads);
+    for (size_t i = 0; i < models.size(); ++i) {
+        pool.submit([&, i] {
+            try {
+                auto start = std::chrono::steady_clock::now();
+                std::vector<CacheSimulator> simulators;
+                simulators.emplace_back(models[i].name(), makeCache(models[i].policy, models[i].config));
+                Simulation simulation(std::move(simulators));
+                program.load(simulation);
+                run(simulation, program, engine);
+                SweepResult& result = results[i];
+                result.model = models[i];
+                result.instructions = simulation.instructions;
+                result.accesses = simulation.simulators[0].overallRequests;
+                result.hits = simulation.simulators[0].Hits;
+                result.writebacks = simulation.simulators[0].writebacks;
+                result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    pool.run();
+    for (const auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+    return results;
+}
+
+inline void writeSweep(std::ostream& out, const std::vector<SweepResult>& results, const std::string& format) {
+    if (format == "json") {
+        out << "[\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const SweepResult& r = results[i];
+            const CacheConfig& c = r.model.config;
+            out << "  {\"policy\": \"" << policyName(r.model.policy) << "\", \"size\": " << c.size
+                << ", \"ways\": " << c.ways << ", \"line\": " << c.lineSize << ", \"sets\": " << c.sets
+                << ", \"instructions\": " << r.instructions << ", \"accesses\": " << r.accesses
+                << ", \"hits\": " << r.hits << ", \"hit_rate\": " << (r.accesses ? 100.0 * r.hits / r.accesses : 0.0)
+                << ", \"writebacks\": " << r.writebacks << ", \"seconds\": " << r.seconds << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "]\n";
+    } else {
+        out << "policy,size,ways,line,sets,instructions,accesses,hits,hit_rate,writebacks,seconds\n";
+        for (const SweepResult& r : results) {
+            const CacheConfig& c = r.model.config;
+            out << policyName(r.model.policy) << "," << c.size << "," << c.ways << "," << c.lineSize << ","
+                << c.sets << "," << r.instructions << "," << r.accesses << "," << r.hits << ","
+                << (r.accesses ? 100.0 * r.hits / r.accesses : 0.0) << "," << r.writebacks << "," << r.seconds << "\n";
+        }
+    }
+}
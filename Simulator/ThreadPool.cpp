@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool for a known batch of tasks: each worker drains its own deque from the back and,
+// when empty, steals from the front of the others. run() returns once every task has finished.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit ThreadPool(unsigned threads) : queues(std::max(1u, threads)) {}
+
+    void submit(Task task) {
+        Queue& queue = queues[next++ % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    void run() {
+        std::vector<std::thread> workers;
+        for (size_t self = 0; self < queues.size(); ++self) {
+            workers.emplace_back([this, self] {
+                Task task;
+                while (take(self, task)) task();
+            });
+        }
+        for (auto& worker : workers) worker.join();
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+    std::vector<Queue> queues;
+    size_t next = 0;
+
+    bool take(size_t self, Task& task) {
+        {
+            Queue& own = queues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); ++i) {
+            Queue& victim = queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+};
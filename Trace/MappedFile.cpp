@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#if defined(_WIN32)
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only contents of a file: memory-mapped on POSIX, read into a buffer elsewhere.
+class MappedFile {
+public:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    explicit MappedFile(const std::string& path) { map(path); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { unmap(); }
+
+    std::string_view text() const { return {reinterpret_cast<const char*>(data), size}; }
+
+private:
+#if defined(_WIN32)
+    std::vector<uint8_t> contents;
+
+    void map(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) throw std::runtime_error("Cannot open file: " + path);
+        contents.assign(std::istreambuf_iterator<char>(file), {});
+        data = contents.data();
+        size = contents.size();
+    }
+    void unmap() {}
+#else
+    void map(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Cannot open file: " + path);
+        struct stat st{};
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("Cannot read file: " + path);
+        }
+        size = st.st_size;
+        if (size > 0) {
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Cannot map file: " + path);
+            }
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            data = static_cast<const uint8_t*>(mapped);
+        }
+        close(fd);
+    }
+    void unmap() {
+        if (data) munmap(const_cast<uint8_t*>(data), size);
+    }
+#endif
+};
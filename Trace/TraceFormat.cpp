@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "Parameters/CommandTypes.cpp"
+
+// Trace file layout:
+//   header  "RVTR" + u32 version
+//   chunks  u32 record count, u32 payload bytes, payload
+// Every chunk restarts the delta state, so chunks decode independently. A record is one tag byte
+// (bit 0 write, bits 1-2 log2 of the access size, bits 3-7 zigzag (pc delta / 4) or 31 when the
+// delta follows as a varint) and a zigzag varint of the address delta.
+
+constexpr char TRACE_MAGIC[4] = {'R', 'V', 'T', 'R'};
+constexpr uint32_t TRACE_VERSION = 1;
+constexpr uint32_t TRACE_CHUNK_RECORDS = 1 << 16;
+constexpr uint32_t TRACE_PC_ESCAPE = 31;
+
+struct TraceRecord {
+    uint32_t address;
+    uint32_t pc;
+    Type type;
+    uint8_t size;       // bytes
+};
+
+struct TraceChunkHeader {
+    uint32_t records;
+    uint32_t bytes;
+};
+
+inline uint32_t zigzag(int32_t x) { return (static_cast<uint32_t>(x) << 1) ^ static_cast<uint32_t>(x >> 31); }
+inline int32_t unzigzag(uint32_t x) { return static_cast<int32_t>(x >> 1) ^ -static_cast<int32_t>(x & 1); }
+
+inline void putVarint(std::vector<uint8_t>& out, uint32_t x) {
+    while (x >= 0x80) {
+        out.push_back(static_cast<uint8_t>(x | 0x80));
+        x >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(x));
+}
+
+inline uint32_t getVarint(const uint8_t*& in, const uint8_t* end) {
+    uint32_t x = 0;
+    for (int shift = 0; shift < 35 && in < end; shift += 7) {
+        uint8_t byte = *in++;
+        x |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return x;
+    }
+    throw std::runtime_error("Corrupted trace chunk");
+}
+
+inline uint8_t sizeLog2(uint8_t size) { return size >= 4 ? 2 : size >> 1; }
+
+inline void encodeChunk(const TraceRecord* records, uint32_t count, std::vector<uint8_t>& out) {
+    uint32_t prevAddress = 0, prevPc = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        const TraceRecord& rec = records[i];
+        uint32_t pcDelta = zigzag(static_cast<int32_t>(rec.pc - prevPc) >> 2);
+        uint8_t tag = (rec.type == Type(w)) | sizeLog2(rec.size) << 1;
+        if (pcDelta < TRACE_PC_ESCAPE) {
+            out.push_back(tag | pcDelta << 3);
+        } else {
+            out.push_back(tag | TRACE_PC_ESCAPE << 3);
+            putVarint(out, pcDelta);
+        }
+        putVarint(out, zigzag(static_cast<int32_t>(rec.address - prevAddress)));
+        prevAddress = rec.address;
+        prevPc = rec.pc;
+    }
+}
+
+// decodes a whole chunk payload into records[0, count)
+inline void decodeChunk(const uint8_t* in, const uint8_t* end, uint32_t count, TraceRecord* records) {
+    uint32_t prevAddress = 0, prevPc = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (in >= end) throw std::runtime_error("Corrupted trace chunk");
+        uint8_t tag = *in++;
+        uint32_t pcDelta = tag >> 3;
+        if (pcDelta == TRACE_PC_ESCAPE) pcDelta = getVarint(in, end);
+        prevPc += static_cast<uint32_t>(unzigzag(pcDelta)) << 2;
+        prevAddress += static_cast<uint32_t>(unzigzag(getVarint(in, end)));
+        records[i] = {prevAddress, prevPc, (tag & 1) ? Type(w) : Type(r), static_cast<uint8_t>(1u << (tag >> 1 & 3))};
+    }
+}
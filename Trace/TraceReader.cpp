@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Trace/MappedFile.cpp"
+#include "Trace/TraceFormat.cpp"
+
+// Read-only view of a trace file. The file is memory-mapped and only the chunk headers are read up
+// front; chunks are decoded on demand, so any number of threads can stream the same trace.
+class TraceReader {
+public:
+    struct Chunk {
+        const uint8_t* payload;
+        uint32_t records;
+        uint32_t bytes;
+    };
+
+    std::vector<Chunk> chunks;
+    uint64_t recordCount = 0;
+
+    explicit TraceReader(const std::string& path) : file(path), data(file.data), size(file.size) {
+        index(path);
+    }
+
+    // buffer must hold TRACE_CHUNK_RECORDS records
+    void decode(const Chunk& chunk, TraceRecord* buffer) const {
+        decodeChunk(chunk.payload, chunk.payload + chunk.bytes, chunk.records, buffer);
+    }
+
+    // calls sink(records, count) for every chunk in order
+    template<class Sink>
+    void forEach(Sink&& sink) const {
+        std::vector<TraceRecord> buffer(TRACE_CHUNK_RECORDS);
+        for (const Chunk& chunk : chunks) {
+            decode(chunk, buffer.data());
+            sink(buffer.data(), chunk.records);
+        }
+    }
+
+private:
+    MappedFile file;
+    const uint8_t* data;
+    size_t size;
+
+    void index(const std::string& path) {
+        if (size < 8 || std::memcmp(data, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0)
+            throw std::runtime_error("Not a trace file: " + path);
+        uint32_t version;
+        std::memcpy(&version, data + 4, sizeof(version));
+        if (version != TRACE_VERSION) throw std::runtime_error("Unsupported trace version in " + path);
+        for (size_t pos = 8; pos < size;) {
+            TraceChunkHeader header{};
+            if (pos + sizeof(header) > size) throw std::runtime_error("Truncated trace file: " + path);
+            std::memcpy(&header, data + pos, sizeof(header));
+            pos += sizeof(header);
+            if (pos + header.bytes > size || header.records > TRACE_CHUNK_RECORDS)
+                throw std::runtime_error("Truncated trace file: " + path);
+            chunks.push_back({data + pos, header.records, header.bytes});
+            recordCount += header.records;
+            pos += header.bytes;
+        }
+    }
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <thread>
+#include "Cache/CacheHierarchy.cpp"
+#include "Cache/CacheSimulator.cpp"
+#include "Analysis/StackDistance.cpp"
+#include "Trace/TraceReader.cpp"
+
+// Feeds a recorded trace to every model without re-executing the program. Models are spread
+// round-robin over the worker threads; each worker decodes the chunks itself, so workers share
+// nothing but the read-only mapping. A worker that fails (a corrupted chunk) stops, and the first
+// error is rethrown once all workers are done.
+inline void replayTrace(const TraceReader& reader, std::vector<CacheSimulator>& simulators,
+                        StackDistance* stackDistance, CacheHierarchy* hierarchy, unsigned threads) {
+    using Sink = std::function<void(const TraceRecord*, uint32_t)>;
+    std::vector<Sink> sinks;
+    for (auto& simulator : simulators) {
+        sinks.emplace_back([&simulator](const TraceRecord* records, uint32_t count) {
+            AccessBatch batch;
+            for (uint32_t i = 0; i < count; ++i) {
+                batch.push(records[i].address, records[i].type, records[i].size, records[i].pc);
+                if (batch.full()) {
+                    simulator.request(batch);
+                    batch.count = 0;
+                }
+            }
+            if (batch.count) simulator.request(batch);
+        });
+    }
+    if (hierarchy) {
+        sinks.emplace_back([hierarchy](const TraceRecord* records, uint32_t count) {
+            for (uint32_t i = 0; i < count; ++i) hierarchy->request(records[i].address, records[i].type, records[i].size);
+        });
+    }
+    if (stackDistance) {
+        sinks.emplace_back([stackDistance](const TraceRecord* records, uint32_t count) {
+            for (uint32_t i = 0; i < count; ++i) stackDistance->request(records[i].address);
+        });
+    }
+
+    threads = std::max(1u, std::min<unsigned>(threads, sinks.size()));
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            try {
+                reader.forEach([&](const TraceRecord* records, uint32_t count) {
+                    for (size_t i = t; i < sinks.size(); i += threads) sinks[i](records, count);
+                });
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    for (const auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
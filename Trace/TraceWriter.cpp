@@ -0,0 +1,112 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "Trace/TraceFormat.cpp"
+
+// Records are appended to a fixed chunk buffer on the simulation thread; full chunks are handed to a
+// background thread that encodes and writes them. Buffers are recycled, so steady-state capture
+// neither allocates nor blocks on I/O.
+class TraceWriter {
+public:
+    explicit TraceWriter(const std::string& path) : path(path), file(path, std::ios::binary) {
+        if (!file) throw std::runtime_error("Cannot open trace file: " + path);
+        file.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+        file.write(reinterpret_cast<const char*>(&TRACE_VERSION), sizeof(TRACE_VERSION));
+        bytesWritten = sizeof(TRACE_MAGIC) + sizeof(TRACE_VERSION);
+        current = takeBuffer();
+        worker = std::thread([this] { run(); });
+    }
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+    ~TraceWriter() { finish(); }
+
+    void record(uint32_t address, Type type, uint8_t size, uint32_t pc) {
+        current[used++] = {address, pc, type, size};
+        if (used == TRACE_CHUNK_RECORDS) submit();
+    }
+
+    // writes what is left; throws when any write failed (a full disk), as the trace is then truncated
+    void close() {
+        finish();
+        if (!file) throw std::runtime_error("Cannot write trace file: " + path);
+    }
+
+    uint64_t recordCount = 0;
+    uint64_t bytesWritten = 0;      // file size, header included
+
+private:
+    using Buffer = std::vector<TraceRecord>;
+    struct Job {
+        Buffer buffer;
+        uint32_t count;
+    };
+
+    std::string path;
+    std::ofstream file;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<Job> jobs;
+    std::vector<Buffer> freeBuffers;
+    bool done = false;
+    Buffer current;
+    uint32_t used = 0;
+
+    void finish() {
+        if (!worker.joinable()) return;
+        if (used) submit();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+        }
+        ready.notify_one();
+        worker.join();
+        file.close();
+    }
+
+    Buffer takeBuffer() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (freeBuffers.empty()) return Buffer(TRACE_CHUNK_RECORDS);
+        Buffer buffer = std::move(freeBuffers.back());
+        freeBuffers.pop_back();
+        return buffer;
+    }
+
+    void submit() {
+        recordCount += used;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back({std::move(current), used});
+        }
+        ready.notify_one();
+        current = takeBuffer();
+        used = 0;
+    }
+
+    void run() {
+        std::vector<uint8_t> payload;
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [this] { return done || !jobs.empty(); });
+                if (jobs.empty()) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            payload.clear();
+            encodeChunk(job.buffer.data(), job.count, payload);
+            TraceChunkHeader header{job.count, static_cast<uint32_t>(payload.size())};
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+            bytesWritten += sizeof(header) + payload.size();
+            std::lock_guard<std::mutex> lock(mutex);
+            freeBuffers.push_back(std::move(job.buffer));
+        }
+    }
+};
@@ -3,718 +3,52 @@
 #include <utility>
 #include <vector>
 #include <string>
-#include <unordered_map>
-#include <sstream>
 #include <map>
 #include <algorithm>
 #include <memory>
+#include <thread>
 #include "Parameters/CacheReplacementPolicies.cpp"
-#include "Cache/CacheLRU.cpp"
-#include "Cache/CachePLRU.cpp"
-
-
-class CacheSimulator {
-public:
-    CacheBase* cache;
-    uint32_t overallRequests = 0;
-    uint32_t Hits = 0;
-    explicit CacheSimulator(CacheBase *cache) : cache(cache), Hits(0) {};
-    void request(Address address, Type type, std::vector<int8_t>& memory) {
-        if (cache->accessMemory(address, type, memory)) ++Hits;
-        ++overallRequests;
-    }
-    [[nodiscard]] double hitRate() const {
-        return static_cast<double>(Hits) / overallRequests * 100;
-    }
-};
-
-class Simulation {
-public:
-    std::vector<CacheSimulator> simulators;
-    std::vector<int32_t> registers;
-    ReplacementPolicy policy_;
-    Simulation(std::vector<CacheSimulator> simulators, ReplacementPolicy policy) : simulators(std::move(simulators)),
-                                                                                   policy_(policy), registers(32) {};
-    void request(Address address, Type type, std::vector<int8_t>& memory) {
-        if (policy_ == ReplacementPolicy(LRU) || policy_ == ReplacementPolicy(ALL))
-            simulators[0].request(address, type, memory);
-        if (policy_ == ReplacementPolicy(PLRU) || policy_ == ReplacementPolicy(ALL))
-            simulators[1].request(address, type, memory);
-    }
-    int32_t getReg(int x) {
-        return registers[x];
-    }
-    void setReg(int32_t x, int32_t data) {
-        if (x < 0 || x >= 32) {
-            std::cerr << "Register index out of bounds: " << x << std::endl;
-            return;
-        }
-        if (x == 0) return;
-        registers[x] = data;
-    }
-    double getHitRate(ReplacementPolicy policy) {
-        if (policy == ReplacementPolicy(LRU)) return simulators[0].hitRate();
-        else return simulators[1].hitRate();
-    }
-    void printResult() {
-        if (policy_ == ReplacementPolicy(ALL) || policy_ == ReplacementPolicy(LRU)) {
-            std::printf("LRU\thit rate: %3.4f%%\n", getHitRate(LRU));
-        }
-        if (policy_ == ReplacementPolicy(ALL) || policy_ == ReplacementPolicy(PLRU)) {
-            std::printf("pLRU\thit rate: %3.4f%%\n", getHitRate(PLRU));
-        }
-    }
-};
-
-Address decodeAddress(uint32_t address) {
-    uint16_t tag = (address >> (CACHE_INDEX_LEN + CACHE_OFFSET_LEN)) & ((1 << CACHE_TAG_LEN) - 1);
-    uint8_t index = (address >> CACHE_OFFSET_LEN) & ((1 << CACHE_INDEX_LEN) - 1);
-    uint8_t offset = address & ((1 << CACHE_OFFSET_LEN) - 1);
-    return {tag, index, offset};
-}
-
-
-
-/*----------------------------- некоторые необходимые значения -------------------------------------------------------*/
-std::map<std::string, int> reg_map = {
-        {"zero", 0}, {"ra", 1}, {"sp", 2}, {"gp", 3}, {"tp", 4}, {"t0", 5}, {"t1", 6}, {"t2", 7},
-        {"s0", 8}, {"fp", 8}, {"s1", 9}, {"a0", 10}, {"a1", 11}, {"a2", 12}, {"a3", 13}, {"a4", 14}, {"a5", 15},
-        {"a6", 16}, {"a7", 17}, {"s2", 18}, {"s3", 19}, {"s4", 20}, {"s5", 21}, {"s6", 22}, {"s7", 23},
-        {"s8", 24}, {"s9", 25}, {"s10", 26}, {"s11", 27}, {"t3", 28}, {"t4", 29}, {"t5", 30}, {"t6", 31},
-        {"x0", 0}, {"x1", 1}, {"x2", 2}, {"x3", 3}, {"x4", 4}, {"x5", 5}, {"x6", 6}, {"x7", 7},
-        {"x8", 8}, {"x9", 9}, {"x10", 10}, {"x11", 11}, {"x12", 12}, {"x13", 13}, {"x14", 14}, {"x15", 15},
-        {"x16", 16}, {"x17", 17}, {"x18", 18}, {"x19", 19}, {"x20", 20}, {"x21", 21}, {"x22", 22}, {"x23", 23},
-        {"x24", 24}, {"x25", 25}, {"x26", 26}, {"x27", 27}, {"x28", 28}, {"x29", 29}, {"x30", 30}, {"x31", 31}
-};
-
-
-enum InstrType {
-    R, I, S, B, U, J
-};
-
-const std::unordered_map<std::string, InstrType> instrMap = {
-        // R
-        {"add",    R}, {"sub",    R}, {"sll",    R}, {"slt",    R}, {"sltu",   R}, {"xor",    R}, {"srl",    R},
-        {"sra",    R}, {"or",     R}, {"and",    R}, {"mul",    R}, {"mulh",   R}, {"mulhsu", R}, {"mulhu",  R},
-        {"div",    R}, {"divu",   R}, {"rem",    R}, {"remu",   R},
-        // I
-        {"addi",   I}, {"lw",     I}, {"slli",   I}, {"slti",   I}, {"sltiu",  I}, {"xori",   I}, {"ori",    I},
-        {"andi",   I}, {"lb",     I}, {"lh",     I}, {"ret",    I}, {"li",     I}, {"jalr",    I}, {"srli", I},
-        {"lbu",    I}, {"lhu",    I}, {"srai",   I},
-        // S
-        {"sw",     S}, {"sb",     S}, {"sh",     S},
-        // B
-        {"beq",    B}, {"bne",    B}, {"blt",    B}, {"bge",    B}, {"bltu",   B}, {"bgeu",   B},
-        // U
-        {"la",     U}, {"lui",    U}, {"auipc",  U},
-        // J
-        {"jal",    J}
-};
-
-
-/*----------------------------- некоторые необходимые значения -------------------------------------------------------*/
-std::vector<int8_t> memory(262144, 0); // bytes
-int pc = 0;
-
-// ФУНКЦИЯ ДЛЯ ПАРСИНГА ДЕСЯТИЧНЫХ И ШЕСТНАДЦАТИРИЧНЫХ ЗНАЧЕНИЙ
-int64_t parseImmediate(const std::string& imm) {
-    try {
-        if (imm.empty()) {
-            return 0;
-        } else if (imm.find("0x") == 0 || imm.find("0X") == 0) {
-            return std::stoull(imm, nullptr, 16);
-        } else if (imm.find("-0x") == 0 || imm.find("-0X") == 0) {
-            return std::stoull(imm, nullptr, 16);
-        } else if (std::isdigit(imm[0]) || imm[0] == '-') {
-            return std::stoull(imm);
-        }
-    } catch (const std::invalid_argument& e) {
-        std::cerr << "Invalid immediate value: " << imm << std::endl;
-        return 0;
-    } catch (const std::out_of_range& e) {
-        std::cerr << "Immediate value out of range: " << imm << std::endl;
-        return 0;
-    }
-}
-
-
-
-/*----------------------------- перевод ассемблера в машинный код -----------------------------------------------------*/
-uint32_t AssemblyToMachineCode(const std::string& mnemonic, const std::vector<std::string>& args, int address) {
-    uint32_t machineCode = 0;
-    auto instr = instrMap.find(mnemonic);
-    if (instr == instrMap.end()) {
-        std::cerr << "Unrecognized instruction mnemonic: " << mnemonic << std::endl;
-        return machineCode;
-    }
-
-    if (instr->second == R) {
-        int rd = reg_map[args[0]];
-        int rs1 = reg_map[args[1]];
-        int rs2 = reg_map[args[2]];
-
-        int funct3, funct7, opcode;
-        if (mnemonic == "add" || mnemonic == "sub" || mnemonic == "mul") {
-            opcode = 0x33;
-            funct3 = (mnemonic == "mul") ? 0 : 0;
-            funct7 = (mnemonic == "sub") ? 0x20 : 0x00;
-            funct7 = (mnemonic == "mul") ? 0x01 : funct7;
-        } else if (mnemonic == "sll") {
-            opcode = 0x33;
-            funct3 = 1;
-            funct7 = 0x00;
-        } else if (mnemonic == "slt") {
-            opcode = 0x33;
-            funct3 = 2;
-            funct7 = 0x00;
-        } else if (mnemonic == "sltu") {
-            opcode = 0x33;
-            funct3 = 3;
-            funct7 = 0x00;
-        } else if (mnemonic == "xor") {
-            opcode = 0x33;
-            funct3 = 4;
-            funct7 = 0x00;
-        } else if (mnemonic == "srl" || mnemonic == "sra") {
-            opcode = 0x33;
-            funct3 = 5;
-            funct7 = (mnemonic == "sra") ? 0x20 : 0x00;
-        } else if (mnemonic == "or") {
-            opcode = 0x33;
-            funct3 = 6;
-            funct7 = 0x00;
-        } else if (mnemonic == "and") {
-            opcode = 0x33;
-            funct3 = 7;
-            funct7 = 0x00;
-        } else if (mnemonic == "mulh") {
-            opcode = 0x33;
-            funct3 = 1;
-            funct7 = 0x01;
-        } else if (mnemonic == "mulhsu") {
-            opcode = 0x33;
-            funct3 = 2;
-            funct7 = 0x01;
-        } else if (mnemonic == "mulhu") {
-            opcode = 0x33;
-            funct3 = 3;
-            funct7 = 0x01;
-        } else if (mnemonic == "div") {
-            opcode = 0x33;
-            funct3 = 4;
-            funct7 = 0x01;
-        } else if (mnemonic == "divu") {
-            opcode = 0x33;
-            funct3 = 5;
-            funct7 = 0x01;
-        } else if (mnemonic == "rem") {
-            opcode = 0x33;
-            funct3 = 6;
-            funct7 = 0x01;
-        } else if (mnemonic == "remu") {
-            opcode = 0x33;
-            funct3 = 7;
-            funct7 = 0x01;
-        } else {
-            return machineCode;
-        }
-        machineCode |= (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
-    } else if (instr->second == I) {
-        int rd, rs1;
-        int64_t imm;
-        int funct3, opcode;
-
-        rd = reg_map[args[0]];
-        rs1 = reg_map[args[1]];
-        imm = parseImmediate(args[2]);
-
-        imm = imm & 0xFFF;
-
-        if (mnemonic == "addi") {
-            opcode = 0x13;
-            funct3 = 0;
-        } else if (mnemonic == "slti") {
-            opcode = 0x13;
-            funct3 = 2;
-        } else if (mnemonic == "sltiu") {
-            opcode = 0x13;
-            funct3 = 3;
-        } else if (mnemonic == "xori") {
-            opcode = 0x13;
-            funct3 = 4;
-        } else if (mnemonic == "ori") {
-            opcode = 0x13;
-            funct3 = 6;
-        } else if (mnemonic == "andi") {
-            opcode = 0x13;
-            funct3 = 7;
-        } else if (mnemonic == "slli") {
-            opcode = 0x13;
-            funct3 = 1;
-            imm &= 0x1F;
-        } else if (mnemonic == "srli" || mnemonic == "srai") {
-            opcode = 0x13;
-            funct3 = 5;
-            if (mnemonic == "srai") {
-                imm |= 0x400;
-            }
-        } else if (mnemonic == "jalr") {
-            opcode = 0x67;
-            funct3 = 0;
-        } else if (mnemonic == "lb") {
-            rd = reg_map[args[0]];
-            rs1 = reg_map[args[2]];
-            imm = parseImmediate(args[1]);
-            opcode = 0x03;
-            funct3 = 0;
-        } else if (mnemonic == "lh") {
-            rd = reg_map[args[0]];
-            rs1 = reg_map[args[2]];
-            imm = parseImmediate(args[1]);
-            opcode = 0x03;
-            funct3 = 1;
-        } else if (mnemonic == "lw") {
-            rd = reg_map[args[0]];
-            rs1 = reg_map[args[2]];
-            imm = parseImmediate(args[1]);
-            opcode = 0x03;
-            funct3 = 2;
-        } else if (mnemonic == "lbu") {
-            rd = reg_map[args[0]];
-            rs1 = reg_map[args[2]];
-            imm = parseImmediate(args[1]);
-            opcode = 0x03;
-            funct3 = 4;
-        } else if (mnemonic == "lhu") {
-            rd = reg_map[args[0]];
-            rs1 = reg_map[args[2]];
-            imm = parseImmediate(args[1]);
-            opcode = 0x03;
-            funct3 = 5;
-        } else {
-            return machineCode;
-        }
-
-        machineCode |= ((imm & 0xFFF) << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
-    }
-    else if (instr->second == S) {
-        int rs1 = reg_map[args[2]];
-        int rs2 = reg_map[args[0]];
-        int imm = parseImmediate(args[1]);
-        int funct3, opcode;
-        if (mnemonic == "sb") funct3 = 0;
-        else if (mnemonic == "sh") funct3 = 1;
-        else if (mnemonic == "sw") funct3 = 2;
-        opcode = 0x23;
-        machineCode |= ((imm & 0xFE0) << 20) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | ((imm & 0x1F) << 7) | opcode;
-    } else if (instr->second == B) {
-        int rs1 = reg_map[args[0]];
-        int rs2 = reg_map[args[1]];
-        int imm = parseImmediate(args[2]);
-        int funct3, opcode;
-
-        if (mnemonic == "beq") funct3 = 0;
-        else if (mnemonic == "bne") funct3 = 1;
-        else if (mnemonic == "blt") funct3 = 4;
-        else if (mnemonic == "bge") funct3 = 5;
-        else if (mnemonic == "bltu") funct3 = 6;
-        else if (mnemonic == "bgeu") funct3 = 7;
-
-        opcode = 0x63;
-
-        int imm_12 = (imm >> 12) & 0x1;
-        int imm_10_5 = (imm >> 5) & 0x3F;
-        int imm_4_1 = (imm >> 1) & 0xF;
-        int imm_11 = (imm >> 11) & 0x1;
-
-        machineCode |= (imm_12 << 31) | (imm_10_5 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12)
-                       | (imm_4_1 << 8) | (imm_11 << 7) | opcode;
-    }
-    else if (instr->second == U) {
-        int rd = reg_map[args[0]];
-        int imm = parseImmediate(args[1]);
-
-        int opcode;
-        if (mnemonic == "lui") opcode = 0x37;
-        else if (mnemonic == "auipc") opcode = 0x17;
-        machineCode |= (imm << 12) | (rd << 7) | opcode;
-    } else if (instr->second == J) {
-        int rd = reg_map[args[0]];
-        int imm = parseImmediate(args[1]);
-        int opcode = 0x6F;
-        machineCode |= ((imm & 0x100000) << 11) | ((imm & 0x7FE) << 20) | ((imm & 0x800) << 9)
-                       | ((imm & 0xFF000) << 12) | (rd << 7) | opcode;
-    }
-
-    return machineCode;
-}
-
-/*---------------------------------- работа кэша с ассемблером -------------------------------------------------------*/
-int32_t readRegister(Simulation& simulation, int reg) {
-    return simulation.getReg(reg);
-}
-
-void writeRegister(Simulation& simulation, int32_t reg, uint32_t value) {
-    simulation.setReg(reg, value);
-}
-
-struct Command {
-    int32_t reg1_{}, reg2_{}, reg3_{};
-    int32_t offset_{};
-    std::function<void(Simulation&)> cmd_{};
-
-    Command(int32_t reg1_, int32_t reg2_, int32_t reg3_, int32_t offset_, const std::function<void(Simulation&)>& cmd_)
-            : reg1_(reg1_), reg2_(reg2_), reg3_(reg3_), offset_(offset_), cmd_(cmd_) {};
-};
-
-
-/*--------------------------------------- работа с ассемблером -------------------------------------------------------*/
-std::vector<Command> parseAssembly(const std::string &asmFile, std::vector<int8_t>& memory, std::vector<uint32_t>& binary) {
-    std::vector<Command> commands;
-    std::ifstream file(asmFile);
-    std::string line;
-
-    int address = 0;
-    while (std::getline(file, line)) {
-        line = line.substr(0, line.find('#'));
-        line.erase(line.begin(), std::find_if(line.begin(), line.end(), [](unsigned char ch) { return !std::isspace(ch); }));
-        line.erase(std::find_if(line.rbegin(), line.rend(), [](unsigned char ch) { return !std::isspace(ch); }).base(), line.end());
-        std::replace(line.begin(), line.end(), ',', ' ');
-        if (line.empty()) { continue; }
-
-        std::istringstream iss(line);
-        std::string mnemonic, arg1, arg2, arg3;
-        iss >> mnemonic;
-
-        if (mnemonic.back() == ':' || mnemonic[0] == '.') {
-            continue;
-        }
-
-        auto instr = instrMap.find(mnemonic);
-        if (instr == instrMap.end()) {
-            std::cerr << "Unrecognized instruction mnemonic: " << mnemonic << std::endl;
-            continue;
-        }
-
-        std::vector<std::string> args;
-        if (instr->second == R || instr->second == I || instr->second == S || instr->second == B) {
-            iss >> arg1 >> arg2 >> arg3;
-            args.push_back(arg1);
-            if (arg2.find('(') != std::string::npos && arg2.find(')') != std::string::npos) {
-                std::size_t pos1 = arg2.find('(');
-                std::size_t pos2 = arg2.find(')');
-                args.push_back(arg2.substr(pos1 + 1, pos2 - pos1 - 1));
-                args.push_back(arg2.substr(0, pos1));
-            } else {
-                args.push_back(arg2);
-                args.push_back(arg3);
-            }
-        } else if (instr->second == U || instr->second == J) {
-            iss >> arg1 >> arg2;
-            args.push_back(arg1);
-            args.push_back(arg2);
-        }
-
-        uint32_t machineCode = AssemblyToMachineCode(mnemonic, args, address);
-        binary.push_back(machineCode);
-
-        int64_t imm = -1;
-        int rd = -1;
-        int rs1 = -1;
-        int rs2 = -1;
-
-        /*---------------R's-------------*/
-        if (instr->second == R) {
-            rd = reg_map[args[0]];
-            rs1 = reg_map[args[1]];
-            rs2 = reg_map[args[2]];
-            if (mnemonic == "add") commands.emplace_back(rd, rs1, rs2, 0, [rd, rs1, rs2](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    writeRegister(simulation, rd, rs1_val + rs2_val);
-                });
-
-            else if (mnemonic == "sub") commands.emplace_back(rd, rs1, rs2, 0, [rd, rs1, rs2](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    writeRegister(simulation, rd, rs1_val - rs2_val);
-                });
-
-            else if (mnemonic == "sll") commands.emplace_back(rd, rs1, rs2, 0, [rd, rs1, rs2](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    writeRegister(simulation, rd, rs1_val << rs2_val);
-                });
-
-            else if (mnemonic == "slt") commands.emplace_back(rd, rs1, rs2, 0, [rd, rs1, rs2](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    writeRegister(simulation, rd, (rs1_val < rs2_val) ? 1 : 0);
-                });
-
-            else if (mnemonic == "sltu") commands.emplace_back(rd, rs1, rs2, 0, [rd, rs1, rs2](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    writeRegister(simulation, rd, (static_cast<uint32_t>(rs1_val) < static_cast<uint32_t>(rs2_val)) ? 1 : 0);
-                });
-
-            else if (mnemonic == "xor") commands.emplace_back(rd, rs1, rs2, 0, [rd, rs1, rs2](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    writeRegister(simulation, rd, rs1_val ^ rs2_val);
-                });
-
-            else if (mnemonic == "srl") commands.emplace_back(rd, rs1, rs2, 0, [rd, rs1, rs2](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    writeRegister(simulation, rd, static_cast<uint32_t>(rs1_val) >> rs2_val);
-                });
-
-            else if (mnemonic == "sra") commands.emplace_back(rd, rs1, rs2, 0, [rd, rs1, rs2](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    writeRegister(simulation, rd, rs1_val >> rs2_val);
-                });
-
-            else if (mnemonic == "or") commands.emplace_back(rd, rs1, rs2, 0, [rd, rs1, rs2](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    writeRegister(simulation, rd, rs1_val | rs2_val);
-                });
-
-            else if (mnemonic == "and") commands.emplace_back(rd, rs1, rs2, 0, [rd, rs1, rs2](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    writeRegister(simulation, rd, rs1_val & rs2_val);
-                });
-
-            else if (mnemonic == "mul") commands.emplace_back(rd, rs1, rs2, 0, [rd, rs1, rs2](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    writeRegister(simulation, rd, rs1_val * rs2_val);
-                });
-        }
-            /*---------------I's-------------*/
-        else if (instr->second == I) {
-            if (mnemonic == "jalr") {
-                rd = reg_map[arg1];
-                rs1 = reg_map[arg2];
-                imm = parseImmediate(arg3);
-            } else {
-                rd = reg_map[args[0]];
-                rs1 = reg_map[args[1]];
-                imm = parseImmediate(args[2]);
-            }
-
-            if (mnemonic == "addi") commands.emplace_back(rd, rs1, 0, imm, [rd, rs1, imm](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    writeRegister(simulation, rd, rs1_val + imm);
-                });
-
-            else if (mnemonic == "slti") commands.emplace_back(rd, rs1, 0, imm, [rd, rs1, imm](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    writeRegister(simulation, rd, (rs1_val < imm) ? 1 : 0);
-                });
-
-            else if (mnemonic == "sltiu") commands.emplace_back(rd, rs1, 0, imm, [rd, rs1, imm](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    writeRegister(simulation, rd, (static_cast<uint32_t>(rs1_val) < static_cast<uint32_t>(imm)) ? 1 : 0);
-                });
-
-            else if (mnemonic == "xori") commands.emplace_back(rd, rs1, 0, imm, [rd, rs1, imm](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    writeRegister(simulation, rd, rs1_val ^ imm);
-                });
-
-            else if (mnemonic == "ori") commands.emplace_back(rd, rs1, 0, imm, [rd, rs1, imm](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    writeRegister(simulation, rd, rs1_val | imm);
-                });
-
-            else if (mnemonic == "andi") commands.emplace_back(rd, rs1, 0, imm, [rd, rs1, imm](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    writeRegister(simulation, rd, rs1_val & imm);
-                });
-
-            else if (mnemonic == "slli") commands.emplace_back(rd, rs1, 0, imm, [rd, rs1, imm](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    writeRegister(simulation, rd, rs1_val << imm);
-                });
-
-            else if (mnemonic == "srli") commands.emplace_back(rd, rs1, 0, imm, [rd, rs1, imm](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    writeRegister(simulation, rd, static_cast<uint32_t>(rs1_val) >> imm);
-                });
-
-            else if (mnemonic == "srai") commands.emplace_back(rd, rs1, 0, imm, [rd, rs1, imm](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    writeRegister(simulation, rd, rs1_val >> imm);
-                });
-            else if (mnemonic == "jalr") commands.emplace_back(rd, rs1, 0, imm, [rd, rs1, imm](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    writeRegister(simulation, rd, pc + 4);
-                    pc = rs1_val + imm;
-                });
-
-            if (mnemonic == "lb" || mnemonic == "lh" || mnemonic == "lw" || mnemonic == "lbu" || mnemonic == "lhu" || mnemonic == "ld") {
-                rd = reg_map[args[0]];
-                rs1 = reg_map[args[2]];
-                imm = parseImmediate(args[1]);
-
-                if (mnemonic == "lb") commands.emplace_back(rd, rs1, 0, imm, [rd, rs1, imm, &memory](Simulation& simulation) {
-                        uint32_t rs1_val = readRegister(simulation, rs1);
-                        uint32_t address = rs1_val + imm;
-                        Address addr = decodeAddress(address);
-                        simulation.request(addr, Type::r, memory);
-                        uint32_t value = static_cast<int8_t>(memory[address]);
-                        writeRegister(simulation, rd, value);
-                    });
-
-                else if (mnemonic == "lh") commands.emplace_back(rd, rs1, 0, imm, [rd, rs1, imm, &memory](Simulation& simulation) {
-                        uint32_t rs1_val = readRegister(simulation, rs1);
-                        uint32_t address = rs1_val + imm;
-                        Address addr = decodeAddress(address);
-                        simulation.request(addr, Type::r, memory);
-                        uint32_t value = *reinterpret_cast<int16_t*>(&memory[address]);
-                        writeRegister(simulation, rd, value);
-                    });
-                else if (mnemonic == "lw") commands.emplace_back(rd, rs1, 0, imm, [rd, rs1, imm, &memory](Simulation& simulation) {
-                        uint32_t rs1_val = readRegister(simulation, rs1);
-                        uint32_t address = rs1_val + imm;
-                        Address addr = decodeAddress(address);
-                        simulation.request(addr, Type::r, memory);
-                        uint32_t value = *reinterpret_cast<int32_t*>(&memory[address]);
-                        writeRegister(simulation, rd, value);
-                    });
-                else if (mnemonic == "lbu") commands.emplace_back(rd, rs1, 0, imm, [rd, rs1, imm, &memory](Simulation& simulation) {
-                        uint32_t rs1_val = readRegister(simulation, rs1);
-                        uint32_t address = rs1_val + imm;
-                        Address addr = decodeAddress(address);
-                        simulation.request(addr, Type::r, memory);
-                        uint32_t value = static_cast<uint8_t>(memory[address]);
-                        writeRegister(simulation, rd, value);
-                    });
-                else if (mnemonic == "lhu") commands.emplace_back(rd, rs1, 0, imm, [rd, rs1, imm, &memory](Simulation& simulation) {
-                        uint32_t rs1_val = readRegister(simulation, rs1);
-                        uint32_t address = rs1_val + imm;
-                        Address addr = decodeAddress(address);
-                        simulation.request(addr, Type::r, memory);
-                        uint32_t value = *reinterpret_cast<uint16_t*>(&memory[address]);
-                        writeRegister(simulation, rd, value);
-                    });
-            }
-        }
-            /*---------------B's-------------*/
-        else if (instr->second == B) {
-            rs1 = reg_map[arg1];
-            rs2 = reg_map[arg2];
-            imm = parseImmediate(arg3);
-
-            if (mnemonic == "beq") commands.emplace_back(rs1, rs2, 0, imm, [rs1, rs2, imm](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    if (rs1_val == rs2_val) pc += imm;
-                });
-
-            else if (mnemonic == "bne") commands.emplace_back(rs1, rs2, 0, imm, [rs1, rs2, imm](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    if (rs1_val != rs2_val) pc += imm;
-                });
-
-            else if (mnemonic == "blt") commands.emplace_back(rs1, rs2, 0, imm, [rs1, rs2, imm](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    if (rs1_val < rs2_val) pc += imm;
-                });
-
-            else if (mnemonic == "bge") commands.emplace_back(rs1, rs2, 0, imm, [rs1, rs2, imm](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    if (rs1_val >= rs2_val) pc += imm;
-                });
-
-            else if (mnemonic == "bltu") commands.emplace_back(rs1, rs2, 0, imm, [rs1, rs2, imm](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    if (static_cast<uint32_t>(rs1_val) < static_cast<uint32_t>(rs2_val)) pc += imm;
-                });
-
-            else if (mnemonic == "bgeu") commands.emplace_back(rs1, rs2, 0, imm, [rs1, rs2, imm](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    if (static_cast<uint32_t>(rs1_val) >= static_cast<uint32_t>(rs2_val)) pc += imm;
-                });
-        }
-            /*---------------S's-------------*/
-        else if (instr->second == S) {
-            rs1 = reg_map[args[2]];
-            rs2 = reg_map[args[0]];
-            imm = parseImmediate(args[1]);
-
-            if (mnemonic == "sb") commands.emplace_back(rs1, rs2, 0, imm, [rs1, rs2, imm, &memory](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    uint32_t address = rs1_val + imm;
-                    Address addr = decodeAddress(address);
-                    simulation.request(addr, Type::w, memory);
-                    memory[address] = static_cast<int8_t>(rs2_val);
-                });
-
-            else if (mnemonic == "sh") commands.emplace_back(rs1, rs2, 0, imm, [rs1, rs2, imm, &memory](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    uint32_t address = rs1_val + imm;
-                    Address addr = decodeAddress(address);
-                    simulation.request(addr, Type::w, memory);
-                    *reinterpret_cast<int16_t*>(&memory[address]) = static_cast<int16_t>(rs2_val);
-                });
-
-            else if (mnemonic == "sw") commands.emplace_back(rs1, rs2, 0, imm, [rs1, rs2, imm, &memory](Simulation& simulation) {
-                    uint32_t rs1_val = readRegister(simulation, rs1);
-                    uint32_t rs2_val = readRegister(simulation, rs2);
-                    uint32_t address = rs1_val + imm;
-                    Address addr = decodeAddress(address);
-                    simulation.request(addr, Type::w, memory);
-                    *reinterpret_cast<int32_t*>(&memory[address]) = static_cast<int32_t>(rs2_val);
-                });
-        }
-
-            /*---------------U's-------------*/
-        else if (instr->second == U) {
-            rd = reg_map[arg1];
-            imm = parseImmediate(arg2);
-
-            if (mnemonic == "lui") commands.emplace_back(rd, 0, 0, imm, [rd, imm](Simulation& simulation) {
-                    writeRegister(simulation, rd, imm << 12);
-                });
-
-            else if (mnemonic == "auipc") commands.emplace_back(rd, 0, 0, imm, [rd, imm](Simulation& simulation) {
-                    writeRegister(simulation, rd, pc + (imm << 12));
-                });
-        }
-            /*---------------J's-------------*/
-        else if (instr->second == J) {
-            rd = reg_map[arg1];
-            imm = parseImmediate(arg2);
-
-            if (mnemonic == "jal") commands.emplace_back(rd, 0, 0, imm, [rd, imm](Simulation& simulation) {
-                    writeRegister(simulation, rd, pc + 4);
-                    pc = imm;
-                });
-        }
-
-        address += 4;
-    }
-
-    return commands;
-}
+#include "Cache/CacheFactory.cpp"
+#include "Simulator/Simulation.cpp"
+#include "Simulator/Assembler.cpp"
+#include "Simulator/Checkpoint.cpp"
+#include "Simulator/Engine.cpp"
+#include "Simulator/MultiHart.cpp"
+#include "Simulator/Loader.cpp"
+#include "Simulator/Sampling.cpp"
+#include "Simulator/Sweep.cpp"
+#include "Trace/TraceReplay.cpp"
 
 
 /*--------------------------------------------------- main -----------------------------------------------------------*/
 int main(int argc, char* argv[]) {
-    std::string asmFile, binFile;
-    ReplacementPolicy policy = ALL;
+    std::string asmFile, binFile, exeFile;
+    std::vector<std::string> policies;
+    std::string prefetchList;
+    std::vector<std::string> prefetchers = {"none"};
+    Engine engine = Engine::Block;
+    CacheConfig config;
+    bool mrc = false;
+    std::string traceOut, traceIn;
+    std::string sweepGrid, sweepOut, sweepFormat = "csv";
+    uint32_t mrcSets = 0;
+    std::vector<std::string> modelSpecs;
+    std::vector<CacheModelSpec> models;
+    std::vector<std::string> levelSpecs;
+    std::string icacheSpec, samplingSpec;
+    std::string checkpointIn, checkpointOut;
+    LatencyModel latency;
+    bool missClasses = false;
+    bool opt = false;
+    bool pipelined = false;
+    uint32_t hartCount = 0;
+    uint64_t quantum = 10000;
+    std::string l2Spec;
+    size_t profileTop = 0;
+    std::string profileOut, profileFormat = "text";
+    uint64_t checkpointAt = 0;
+    std::vector<CacheLevelSpec> levels;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
 
     try {
         if (argc == 1) throw std::runtime_error("No arguments were provided");
@@ -724,14 +58,136 @@ int main(int argc, char* argv[]) {
             if (arg == "--asm") {
                 if (++i < argc) asmFile = argv[i];
                 else throw std::runtime_error("No assembly file specified.");
+            } else if (arg == "--exe") {
+                if (++i < argc) exeFile = argv[i];
+                else throw std::runtime_error("No executable file specified.");
             } else if (arg == "--bin") {
                 if (++i < argc) binFile = argv[i];
                 else throw std::runtime_error("No binary file specified.");
             } else if (arg == "--replacement") {
-                if (++i < argc) policy = static_cast<ReplacementPolicy>(std::stoi(argv[i]));
-                else throw std::runtime_error("No replacement policy specified.");
+                if (++i < argc) {
+                    auto policy = static_cast<ReplacementPolicy>(std::stoi(argv[i]));
+                    if (policy == ALL) policies = {policyKey(LRU), policyKey(PLRU), policyKey(BIT_PLRU)};
+                    else if (*policyKey(policy)) policies = {policyKey(policy)};
+                    else throw std::runtime_error("Unknown replacement policy number: " + std::string(argv[i]));
+                } else throw std::runtime_error("No replacement policy specified.");
+            } else if (arg == "--policies") {
+                if (++i < argc) policies = parsePolicyList(argv[i]);
+                else throw std::runtime_error("No replacement policies specified.");
+            } else if (arg == "--prefetch") {
+                if (++i < argc) prefetchList = argv[i];
+                else throw std::runtime_error("No prefetchers specified.");
+            } else if (arg == "--engine") {
+                if (++i < argc) engine = parseEngine(argv[i]);
+                else throw std::runtime_error("No engine specified.");
+            } else if (arg == "--trace-out") {
+                if (++i < argc) traceOut = argv[i];
+                else throw std::runtime_error("No trace file specified.");
+            } else if (arg == "--trace-in") {
+                if (++i < argc) traceIn = argv[i];
+                else throw std::runtime_error("No trace file specified.");
+            } else if (arg == "--model") {
+                if (++i < argc) modelSpecs.emplace_back(argv[i]);
+                else throw std::runtime_error("No model specified.");
+            } else if (arg == "--level") {
+                if (++i < argc) levelSpecs.emplace_back(argv[i]);
+                else throw std::runtime_error("No cache level specified.");
+            } else if (arg == "--icache") {
+                if (++i < argc) icacheSpec = argv[i];
+                else throw std::runtime_error("No instruction cache specified.");
+            } else if (arg == "--sample") {
+                if (++i < argc) samplingSpec = argv[i];
+                else throw std::runtime_error("No sampling parameters specified.");
+            } else if (arg == "--checkpoint-in") {
+                if (++i < argc) checkpointIn = argv[i];
+                else throw std::runtime_error("No checkpoint file specified.");
+            } else if (arg == "--checkpoint-out") {
+                if (++i < argc) checkpointOut = argv[i];
+                else throw std::runtime_error("No checkpoint file specified.");
+            } else if (arg == "--checkpoint-at") {
+                if (++i < argc) checkpointAt = std::stoull(argv[i]);
+                else throw std::runtime_error("No instruction count specified.");
+            } else if (arg == "--latency") {
+                if (++i < argc) latency = LatencyModel::parse(argv[i]);
+                else throw std::runtime_error("No latencies specified.");
+            } else if (arg == "--miss-classes") {
+                missClasses = true;
+            } else if (arg == "--opt") {
+                opt = true;
+            } else if (arg == "--pipeline") {
+                pipelined = true;
+            } else if (arg == "--harts") {
+                if (++i < argc) hartCount = std::stoul(argv[i]);
+                else throw std::runtime_error("No hart count specified.");
+                if (hartCount == 0) throw std::runtime_error("--harts needs at least one hart");
+            } else if (arg == "--quantum") {
+                if (++i < argc) quantum = std::stoull(argv[i]);
+                else throw std::runtime_error("No instruction count specified.");
+                if (quantum == 0) throw std::runtime_error("--quantum needs at least one instruction");
+            } else if (arg == "--l2") {
+                if (++i < argc) l2Spec = argv[i];
+                else throw std::runtime_error("No L2 specified.");
+            } else if (arg == "--profile") {
+                if (++i < argc) profileTop = std::stoul(argv[i]);
+                else throw std::runtime_error("No instruction count specified.");
+                if (profileTop == 0) throw std::runtime_error("--profile needs at least one instruction");
+            } else if (arg == "--profile-out") {
+                if (++i < argc) profileOut = argv[i];
+                else throw std::runtime_error("No profile output file specified.");
+            } else if (arg == "--profile-format") {
+                if (++i < argc) profileFormat = argv[i];
+                else throw std::runtime_error("No profile format specified.");
+                if (profileFormat != "text" && profileFormat != "json") throw std::runtime_error("Profile format must be text or json");
+            } else if (arg == "--threads") {
+                if (++i < argc) threads = std::max(1, std::stoi(argv[i]));
+                else throw std::runtime_error("No thread count specified.");
+            } else if (arg == "--sweep") {
+                if (++i < argc) sweepGrid = argv[i];
+                else throw std::runtime_error("No sweep grid specified.");
+            } else if (arg == "--sweep-out") {
+                if (++i < argc) sweepOut = argv[i];
+                else throw std::runtime_error("No sweep output file specified.");
+            } else if (arg == "--sweep-format") {
+                if (++i < argc) sweepFormat = argv[i];
+                else throw std::runtime_error("No sweep format specified.");
+                if (sweepFormat != "csv" && sweepFormat != "json") throw std::runtime_error("Sweep format must be csv or json");
+            } else if (arg == "--mrc") {
+                mrc = true;
+            } else if (arg == "--mrc-sets") {
+                if (++i < argc) mrcSets = std::stoul(argv[i]);
+                else throw std::runtime_error("No set count specified.");
+                mrc = true;
+            } else if (arg == "--config") {
+                if (++i < argc) config.load(argv[i]);
+                else throw std::runtime_error("No config file specified.");
+            } else if (arg == "--cache-size" || arg == "--ways" || arg == "--line-size" || arg == "--addr-len") {
+                static const std::map<std::string, std::string> keys = {
+                        {"--cache-size", "size"}, {"--ways", "ways"}, {"--line-size", "line"}, {"--addr-len", "addr"}
+                };
+                if (++i < argc) config.set(keys.at(arg), argv[i]);
+                else throw std::runtime_error("No value specified for " + arg);
             }
         }
+        config.derive();
+        if (checkpointAt && checkpointOut.empty()) throw std::runtime_error("--checkpoint-at needs --checkpoint-out");
+        if (profileTop && !traceIn.empty()) throw std::runtime_error("--profile needs a program to run, not a trace");
+        if (opt && (!samplingSpec.empty() || !checkpointIn.empty() || !checkpointOut.empty() || !sweepGrid.empty()))
+            throw std::runtime_error("--opt needs the whole access stream of a single run, not a sampled, checkpointed or sweep run");
+        if (mrcSets == 0) mrcSets = config.sets;
+        if (!CacheConfig::isPowerOfTwo(mrcSets)) throw std::runtime_error("Number of sets must be a power of two");
+        for (const auto& spec : modelSpecs) models.push_back(parseModelSpec(spec, config));
+        for (const auto& spec : levelSpecs) levels.push_back(parseLevelSpec(spec, config));
+        if (pipelined && (profileTop || !traceIn.empty() || hartCount))
+            throw std::runtime_error("--pipeline needs a single-hart program run without --profile "
+                                     "(trace replay already gives every model a thread)");
+        if (hartCount && (!traceIn.empty() || !traceOut.empty() || !sweepGrid.empty() || !samplingSpec.empty() ||
+                          !checkpointIn.empty() || !checkpointOut.empty() || profileTop || opt || mrc ||
+                          !levels.empty() || !icacheSpec.empty() || models.size() > 1 || !prefetchList.empty()))
+            throw std::runtime_error("--harts runs its own cache system: at most one --model (the L1s) and --l2");
+        if (!prefetchList.empty() && (!sweepGrid.empty() || (models.empty() && !levels.empty())))
+            throw std::runtime_error("--prefetch applies to the flat cache models, not to sweeps or hierarchies");
+        if (!prefetchList.empty()) prefetchers = parsePrefetcherList(prefetchList, config);
+        if (policies.empty()) policies = {policyKey(LRU), policyKey(PLRU), policyKey(BIT_PLRU)};
     } catch (const std::exception& e) {
         std::cerr << "Error parsing command-line arguments: " << e.what() << std::endl;
         return 1;
@@ -739,29 +195,147 @@ int main(int argc, char* argv[]) {
 
     try {
 
-        CacheLRU cache_LRU; CachePLRU cache_pLRU;
-        CacheSimulator cache_LRU_sim(&cache_LRU); CacheSimulator cache_pLRU_sim(&cache_pLRU);
-        Simulation simulation({cache_LRU_sim, cache_pLRU_sim}, policy);
+        // every flat model once per prefetcher
+        std::vector<CacheSimulator> simulators;
+        auto addModel = [&](const std::string& name, const std::string& policy, const CacheConfig& c) {
+            for (const auto& prefetcher : prefetchers) {
+                simulators.emplace_back(name, makeCache(policy, c));
+                if (auto attached = makePrefetcher(prefetcher, c))
+                    simulators.back().attachPrefetcher(std::move(attached), latency);
+            }
+        };
+        for (const auto& model : models) addModel(model.name(), model.policy, model.config);
+        if (models.empty() && levels.empty()) {
+            for (const auto& p : policies) addModel(policyName(p), p, config);
+        }
+        ScratchFile optScratch;     // the temporary trace of --opt, removed however the run ends
+        Simulation simulation(std::move(simulators));
+        if (!levels.empty()) simulation.hierarchy = std::make_unique<CacheHierarchy>(levels);
+        if (!icacheSpec.empty()) {
+            CacheModelSpec icache = parseModelSpec(icacheSpec, config);
+            simulation.icache = std::make_unique<CacheSimulator>("I-cache " + icache.name(),
+                                                                 makeCache(icache.policy, icache.config));
+        }
+        simulation.latency = latency;
+        if (pipelined) simulation.pipeline = std::make_unique<ModelPipeline>(simulation.simulators);
+        if (missClasses) {
+            for (CacheSimulator& simulator : simulation.simulators) simulator.classifyMisses();
+            if (simulation.icache) simulation.icache->classifyMisses();
+            if (simulation.hierarchy) simulation.hierarchy->classifyMisses();
+        }
+        if (opt) {
+            if (simulation.simulators.empty()) throw std::runtime_error("--opt needs a flat cache model");
+            // one OPT per distinct geometry
+            for (const CacheSimulator& simulator : simulation.simulators) {
+                const CacheConfig& c = simulator.cache->config;
+                if (std::none_of(simulation.opt.begin(), simulation.opt.end(), [&](const BeladyOPT& o) {
+                    return o.config.size == c.size && o.config.ways == c.ways && o.config.lineSize == c.lineSize &&
+                           o.config.addrLen == c.addrLen;
+                })) simulation.opt.emplace_back(c);
+            }
+        }
+        if (mrc) simulation.stackDistance = std::make_unique<StackDistance>(mrcSets, config.lineSize);
+
+        /*------------------- воспроизведение трассы ---------------*/
+        if (!traceIn.empty()) {
+            TraceReader reader(traceIn);
+            replayTrace(reader, simulation.simulators, simulation.stackDistance.get(), simulation.hierarchy.get(), threads);
+            runOPT(simulation.opt, reader, threads);
+            simulation.printResult();
+            return 0;
+        }
+
+        // OPT needs the future, so the run is recorded and OPT replays it afterwards
+        std::string optTrace = traceOut;
+        if (opt && optTrace.empty()) optTrace = optScratch.path = optScratchPath(".trc");
+        if (!optTrace.empty()) simulation.traceWriter = std::make_unique<TraceWriter>(optTrace);
         std::vector<uint32_t> binary;
-        auto commands = parseAssembly(asmFile, memory, binary);
+        Program program;
+        if (!exeFile.empty()) {
+            program = loadExecutable(exeFile);
+        } else {
+            program = parseAssembly(asmFile, binary);
 
-        /*------------------- запись бин кода в файл ---------------*/
-        std::ofstream binFileOut(binFile, std::ios::binary);
-        for (auto code : binary) {
-            binFileOut.write(reinterpret_cast<const char*>(&code), sizeof(code));
+            /*------------------- запись бин кода в файл ---------------*/
+            std::ofstream binFileOut(binFile, std::ios::binary);
+            for (auto code : binary) {
+                binFileOut.write(reinterpret_cast<const char*>(&code), sizeof(code));
+            }
+            binFileOut.close();
         }
-        binFileOut.close();
 
 
+        /*------------------- перебор конфигураций -----------------*/
+        if (!sweepGrid.empty()) {
+            int skipped = 0;
+            auto sweepModels = parseSweepGrid(sweepGrid, config, skipped);
+            if (skipped) std::cerr << "Skipped " << skipped << " invalid cache configurations" << std::endl;
+            auto results = runSweep(program, sweepModels, threads, engine);
+            if (sweepOut.empty()) {
+                writeSweep(std::cout, results, sweepFormat);
+            } else {
+                std::ofstream out(sweepOut);
+                writeSweep(out, results, sweepFormat);
+            }
+            return 0;
+        }
+
+        if (hartCount) {
+            CacheModelSpec l1;
+            if (models.empty()) l1.config = config;
+            else l1 = models[0];
+            CacheModelSpec l2 = parseModelSpec("size=" + std::to_string(l1.config.size * 16) + ",ways=8," + l2Spec, l1.config);
+            MultiHart machine(program, hartCount, l1, l2);
+            machine.run(engine, quantum);
+            machine.print();
+            return 0;
+        }
+
         /*---------------------- работа с кэшем --------------------*/
-        while (pc / 4 < (int)commands.size()) {
-            auto save_pc = pc;
-            commands[pc / 4].cmd_(simulation);
-            if (pc == save_pc) pc += 4;
-            if (pc == 0) break;
+        if (checkpointIn.empty()) program.load(simulation);
+        else restoreCheckpoint(checkpointIn, simulation, program);
+        if (profileTop)
+            simulation.profile = std::make_unique<PcProfile>(simulation.profiledModel(), program.base, program.code.size());
+        if (!checkpointOut.empty()) {
+            Runner runner(simulation, program, engine);
+            runner.run(checkpointAt);
+            uint64_t bytes = saveCheckpoint(checkpointOut, simulation, program);
+            std::printf("checkpoint\t%llu instructions, %llu bytes\n", (unsigned long long)simulation.instructions,
+                        (unsigned long long)bytes);
+            return 0;
+        }
+        if (!samplingSpec.empty()) {
+            SamplingReport report = runSampled(simulation, program, engine, SamplingConfig::parse(samplingSpec));
+            report.print(simulation);
+            return 0;
+        }
+        run(simulation, program, engine);
+        if (opt) {
+            simulation.traceWriter->close();
+            {
+                TraceReader reader(optTrace);
+                runOPT(simulation.opt, reader, threads);
+            }
         }
 
-        simulation.printResult();
+        // a JSON profile on stdout stands alone, so stdout stays parseable
+        bool jsonToStdout = simulation.profile && profileFormat == "json" && profileOut.empty();
+        if (!jsonToStdout) simulation.printResult();
+        if (simulation.profile) {
+            if (profileOut.empty()) {
+                std::fflush(stdout);
+                simulation.profile->write(std::cout, profileFormat, profileTop, program.source, program.lines);
+            } else {
+                std::ofstream out(profileOut);
+                simulation.profile->write(out, profileFormat, profileTop, program.source, program.lines);
+            }
+        }
+        if (!traceOut.empty()) {
+            simulation.traceWriter->close();
+            if (!jsonToStdout)
+                std::printf("trace\t%llu accesses, %llu bytes\n", (unsigned long long)simulation.traceWriter->recordCount,
+                            (unsigned long long)simulation.traceWriter->bytesWritten);
+        }
 
 
     } catch (const std::exception& e) {